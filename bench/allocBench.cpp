@@ -0,0 +1,64 @@
+/*
+Allocation benchmark: global heap allocations on the steady-state move phase and order paths.
+Every unit holds each phase; after warm-up phases have sized the move phase scratch, the
+phase resolution and order storing must not allocate. Exits 1 if they do.
+
+Usage:
+`allocBench ($territories ...)`, default 1000 10000
+Output is one JSON object per line (std output):
+`{"bench":"allocations","fixture":"$territories/$players","phases":$n,"phase":$n,"order":$n,"adjudicate":$n,"legalOrders":$n}`
+counts are allocations per call in the measured phases; phase and order must be 0.
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN -DPIS_COUNT_ALLOCATIONS bench/allocBench.cpp -o allocBench`
+*/
+
+#include "benchCommon.h"
+
+#ifndef PIS_COUNT_ALLOCATIONS
+#error "allocBench needs -DPIS_COUNT_ALLOCATIONS"
+#endif
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {1000, 10000});
+    const int warmup = 3, phases = 20;
+    bool clean = true;
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        fixture.generated.rules["buildTime"] = 0; // move phases only
+        std::ofstream(fixture.rulesPath) << fixture.generated.rules.dump();
+        FixtureDirectory inFixture(fixture);
+        {
+            Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+            game.initialize();
+            std::vector<std::string> holds;
+            for (size_t p = 1; p <= fixture.spec.players; p++) {
+                std::string name = "P" + std::to_string(p);
+                for (const std::string& order : game.legalOrders(game.player(name))) {
+                    if (std::count(order.begin(), order.end(), ' ') == 1 && order.back() == 'H') {
+                        holds.push_back("diplomacy --order " + name + " " + order);
+                    }
+                }
+            }
+            json before;
+            for (int phase = 0; phase < warmup + phases; phase++) {
+                if (phase == warmup) before = game.allocationStats();
+                for (const std::string& hold : holds) game.command(hold);
+                for (size_t p = 1; p <= fixture.spec.players; p++) game.legalOrders(game.player("P" + std::to_string(p)));
+                game.adjudicate();
+            }
+            json after = game.allocationStats();
+            json result{{"bench", "allocations"}, {"fixture", fixture.name()}, {"phases", phases}};
+            for (const char* section : {"phase", "order", "adjudicate", "legalOrders"}) {
+                uint64_t calls = after[section]["calls"].get<uint64_t>() - before[section]["calls"].get<uint64_t>();
+                uint64_t count = after[section]["allocations"].get<uint64_t>() - before[section]["allocations"].get<uint64_t>();
+                result[section] = calls ? double(count) / double(calls) : 0.0;
+            }
+            std::cout << result.dump() << std::endl;
+            if (result["phase"] != 0.0 || result["order"] != 0.0) {
+                std::cerr << "Error: steady-state allocations on " << fixture.name() << std::endl;
+                clean = false;
+            }
+        }
+    }
+    return clean ? 0 : 1;
+}
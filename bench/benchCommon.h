@@ -0,0 +1,141 @@
+/*
+Shared fixtures and timing for the benchmark binaries in this directory.
+
+Each benchmark is a single translation unit including this header, built with e.g.
+`g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/loadBench.cpp -o loadBench`
+
+Output is one JSON object per benchmark line (std output):
+`{"bench": $name, "fixture": "$territories/$players", "iterations": $n, "nsPerOp": $median, "minNsPerOp": $min, "samples": [$nsPerOp, ...]}`
+Samples are repetitions of `iterations` operations each, after one warm-up repetition; a body
+call may count as several operations (e.g. one per position of a batch).
+*/
+
+#pragma once
+
+#include "../pisDiplomacy.cpp"
+#include "../tools/mapGenerator.cpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <unistd.h>
+
+// A generated map written to a temporary directory, removed again on destruction.
+struct Fixture {
+    MapSpec spec;
+    GeneratedMap generated;
+    std::string directory;
+    std::string mapPath;
+    std::string rulesPath;
+    std::string logPath; // for the games played on this fixture, one after another
+    std::vector<std::string> moveOrders; // every starting unit moves to its first neighbor
+
+    Fixture(size_t territories, size_t players, uint32_t seed = 1) {
+        spec.territories = territories;
+        spec.players = players;
+        spec.seed = seed;
+        generated = generateMap(spec);
+        char pattern[] = "/tmp/pisBenchXXXXXX";
+        if (!mkdtemp(pattern)) throw std::runtime_error("Cannot create temporary directory");
+        directory = pattern;
+        mapPath = directory + "/map.json";
+        rulesPath = directory + "/rules.json";
+        logPath = directory + "/log.json";
+        std::ofstream(mapPath) << generated.map.dump();
+        std::ofstream(rulesPath) << generated.rules.dump();
+        for (auto& [territoryName, territory] : generated.map.items()) {
+            if (territory["initPlayer"].is_null()) continue;
+            std::string partName = territory["initPart"];
+            const json& neighbors = territory[partName];
+            if (neighbors.empty()) continue;
+            std::string target = neighbors[0];
+            if (target.find('_') == std::string::npos) target += partName.back() == 'L' ? "_L" : "_C";
+            moveOrders.push_back("diplomacy --order " + territory["initPlayer"].get<std::string>() + " "
+                + partName + " M to " + target);
+        }
+    }
+    ~Fixture() {
+        for (const std::string& path : {mapPath, rulesPath, logPath}) std::remove(path.c_str());
+        rmdir(directory.c_str());
+    }
+    std::string name() const { return std::to_string(spec.territories) + "/" + std::to_string(spec.players); }
+};
+
+// Makes the fixture's directory the working directory while in scope, so files a game writes
+// next to it land there, then restores the previous one. Declare it after the fixture.
+struct FixtureDirectory {
+    std::filesystem::path previous;
+    explicit FixtureDirectory(const Fixture& fixture) : previous(std::filesystem::current_path()) {
+        std::filesystem::current_path(fixture.directory);
+    }
+    ~FixtureDirectory() {
+        std::error_code ignored;
+        std::filesystem::current_path(previous, ignored);
+    }
+};
+
+// Territory counts given on the command line, or the benchmark's defaults if there are none.
+inline std::vector<size_t> sizesFrom(int argc, char** argv, std::vector<size_t> defaults) {
+    if (argc <= 1) return defaults;
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(std::stoul(argv[i]));
+    return sizes;
+}
+
+inline long residentKb() {
+    long pages = 0, resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        std::fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One random legal order per unit for a self-play phase; a single build or disband in build phases.
+inline std::vector<std::string> randomOrders(const std::vector<std::string>& legal, std::mt19937& rng) {
+    std::vector<std::string> chosen;
+    if (legal.empty()) return chosen;
+    bool adjustment = std::all_of(legal.begin(), legal.end(), [](const std::string& order) {
+        return std::count(order.begin(), order.end(), ' ') == 1 && (order.back() == 'B' || order.back() == 'D');
+    });
+    if (adjustment) {
+        if (rng() % 2) chosen.push_back(legal[rng() % legal.size()]);
+        return chosen;
+    }
+    for (size_t first = 0; first < legal.size();) {
+        std::string_view unit = std::string_view(legal[first]).substr(0, legal[first].find(' '));
+        size_t last = first;
+        while (last < legal.size() && std::string_view(legal[last]).substr(0, legal[last].find(' ')) == unit) last++;
+        chosen.push_back(legal[first + rng() % (last - first)]);
+        first = last;
+    }
+    return chosen;
+}
+
+// Keeps the optimizer from discarding a benchmarked result.
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Times `iterations` calls of body(i) per repetition, each worth `operationsPerCall` operations,
+// and prints one result line.
+template <typename Body>
+void runBench(const std::string& name, const Fixture& fixture, size_t iterations, Body body,
+    size_t operationsPerCall = 1, int repetitions = 7) {
+    std::vector<double> samples;
+    for (int r = 0; r <= repetitions; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) body(i);
+        double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (r > 0) samples.push_back(nanoseconds / double(iterations * operationsPerCall));
+    }
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    std::cout << json{{"bench", name}, {"fixture", fixture.name()}, {"iterations", iterations * operationsPerCall},
+        {"nsPerOp", sorted[sorted.size() / 2]}, {"minNsPerOp", sorted.front()}, {"samples", samples}}.dump() << std::endl;
+}
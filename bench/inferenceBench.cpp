@@ -0,0 +1,78 @@
+/*
+Inference benchmark: a random-weight network of two 64-wide graph convolutions, a per-part
+dense layer, mean pooling and a dense head, over the generated map's parts.
+- "inferenceF32/$batch", "inferenceI8/$batch": InferenceNetwork::evaluate on batches of positions
+- "inferenceQueue": 8 threads submitting single positions through an InferenceQueue
+nsPerOp is per position.
+
+Usage:
+`inferenceBench ($territories ...)`, default 100 1000
+Output format is described in benchCommon.h.
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/inferenceBench.cpp -o inferenceBench`
+*/
+
+#include "benchCommon.h"
+
+static json randomMatrix(std::mt19937& rng, size_t rows, size_t columns) {
+    std::normal_distribution<float> normal(0.0f, 1.0f / std::sqrt(float(columns)));
+    json matrix = json::array();
+    for (size_t r = 0; r < rows; r++) {
+        json row = json::array();
+        for (size_t c = 0; c < columns; c++) row.push_back(normal(rng));
+        matrix.push_back(row);
+    }
+    return matrix;
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {100, 1000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+        game.initialize();
+
+        std::mt19937 rng(fixture.spec.seed);
+        const size_t width = 64;
+        json network{{"features", Game::partFeatures}, {"layers", json::array({
+            {{"type", "graphConv"}, {"self", randomMatrix(rng, width, Game::partFeatures)},
+                {"neighbor", randomMatrix(rng, width, Game::partFeatures)}, {"bias", json(std::vector<float>(width))}, {"activation", "relu"}},
+            {{"type", "graphConv"}, {"self", randomMatrix(rng, width, width)},
+                {"neighbor", randomMatrix(rng, width, width)}, {"bias", json(std::vector<float>(width))}, {"activation", "relu"}},
+            {{"type", "dense"}, {"weights", randomMatrix(rng, width, width)}, {"bias", json(std::vector<float>(width))}, {"activation", "relu"}},
+            {{"type", "meanPool"}},
+            {{"type", "dense"}, {"weights", randomMatrix(rng, fixture.spec.players + 1, width)},
+                {"bias", json(std::vector<float>(fixture.spec.players + 1))}}})}};
+        std::string networkPath = fixture.directory + "/network.json";
+        std::ofstream(networkPath) << network.dump();
+        InferenceNetwork fp32(networkPath, game.partGraph());
+        InferenceNetwork int8(networkPath, game.partGraph());
+        int8.quantize();
+        std::remove(networkPath.c_str());
+
+        std::vector<float> position = game.encodeParts(game.player("P1"));
+        for (size_t batch : {size_t(1), size_t(32)}) {
+            std::vector<float> inputs, results(batch * fp32.outputSize());
+            for (size_t b = 0; b < batch; b++) inputs.insert(inputs.end(), position.begin(), position.end());
+            runBench("inferenceF32/" + std::to_string(batch), fixture, std::max<size_t>(1, 64 / batch), [&](size_t) {
+                fp32.evaluate(inputs.data(), batch, results.data());
+            }, batch);
+            runBench("inferenceI8/" + std::to_string(batch), fixture, std::max<size_t>(1, 64 / batch), [&](size_t) {
+                int8.evaluate(inputs.data(), batch, results.data());
+            }, batch);
+        }
+
+        InferenceQueue queue(fp32, 32);
+        const size_t threads = 8, perThread = 8;
+        runBench("inferenceQueue", fixture, 1, [&](size_t) {
+            std::vector<std::thread> games;
+            for (size_t t = 0; t < threads; t++) {
+                games.emplace_back([&]() {
+                    for (size_t k = 0; k < perThread; k++) keep(queue.submit(position).get().size());
+                });
+            }
+            for (auto& thread : games) thread.join();
+        }, threads * perThread);
+    }
+    return 0;
+}
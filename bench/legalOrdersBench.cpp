@@ -0,0 +1,27 @@
+/*
+Legal order generation benchmark: Game::legalOrders for one player per operation, cycling
+through the players of the opening move phase.
+
+Usage:
+`legalOrdersBench ($territories ...)`, default 1000 10000
+Output format is described in benchCommon.h, bench "legalOrders".
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/legalOrdersBench.cpp -o legalOrdersBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {1000, 10000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+        game.initialize();
+        std::vector<const Player*> players;
+        for (size_t p = 1; p <= fixture.spec.players; p++) players.push_back(game.player("P" + std::to_string(p)));
+        runBench("legalOrders", fixture, players.size() * 20, [&](size_t i) {
+            keep(game.legalOrders(players[i % players.size()]).size());
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+/*
+Map loading benchmark: Game construction plus initialize() from map.json and rules.json.
+
+Usage:
+`loadBench ($territories ...)`, default 100 1000 10000
+Output format is described in benchCommon.h, bench "load".
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/loadBench.cpp -o loadBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {100, 1000, 10000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        size_t iterations = std::max<size_t>(1, 20000 / territories);
+        runBench("load", fixture, iterations, [&](size_t) {
+            Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+            game.initialize();
+            keep(game.stateHash());
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+Log writing benchmark: appending one phase of orders to log.json. Runs move phases with every
+unit ordered and reports the "log" section of Game::latencyStats, which times only the write.
+The game logs to the fixture's log.json, which is removed with the fixture.
+
+Usage:
+`logBench ($territories ...)`, default 1000 10000
+Output is one JSON object per line (std output):
+`{"bench":"logWrite","fixture":"$territories/$players","iterations":$phases,"p50Ns":$ns,"p99Ns":$ns,"maxNs":$ns}`
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/logBench.cpp -o logBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {1000, 10000});
+    const int phases = 50;
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        FixtureDirectory inFixture(fixture);
+        {
+            Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+            game.initialize();
+            for (int phase = 0; phase < phases; phase++) {
+                for (size_t p = 1; p <= fixture.spec.players; p++) {
+                    std::string name = "P" + std::to_string(p);
+                    for (const std::string& order : game.legalOrders(game.player(name))) {
+                        if (std::count(order.begin(), order.end(), ' ') == 1 && order.back() == 'H') game.command("diplomacy --order " + name + " " + order);
+                    }
+                }
+                game.adjudicate();
+            }
+            json log = game.latencyStats()["log"];
+            std::cout << json{{"bench", "logWrite"}, {"fixture", fixture.name()}, {"iterations", log["count"]},
+                {"p50Ns", log["p50"]}, {"p99Ns", log["p99"]}, {"maxNs", log["max"]}}.dump() << std::endl;
+        }
+    }
+    return 0;
+}
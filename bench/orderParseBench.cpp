@@ -0,0 +1,26 @@
+/*
+Order parsing benchmark: one `--order` command line per operation, from text to the stored
+order. The same unit orders are resubmitted every repetition, so each replaces its earlier copy.
+
+Usage:
+`orderParseBench ($territories ...)`, default 1000 10000
+Output format is described in benchCommon.h, bench "orderParse".
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/orderParseBench.cpp -o orderParseBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {1000, 10000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+        game.initialize();
+        const std::vector<std::string>& orders = fixture.moveOrders;
+        runBench("orderParse", fixture, orders.size() * 10, [&](size_t i) {
+            game.command(orders[i % orders.size()]);
+        });
+    }
+    return 0;
+}
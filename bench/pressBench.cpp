@@ -0,0 +1,64 @@
+/*
+Press benchmarks on a PressStore with its PressIndex, as Game::sendPress feeds them:
+- "pressInsert": append one message and index it
+- "pressQuery": one word query over the filled store
+- "pressUnread": one recipient fetching its new messages after every insertion
+Messages are drawn from a fixed vocabulary mentioning territories and players.
+
+Usage:
+`pressBench ($messages ...)`, default 10000 100000
+Output format is described in benchCommon.h; the fixture is the generated 1000 territory map.
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/pressBench.cpp -o pressBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {10000, 100000});
+    Fixture fixture(1000, 7);
+    const uint players = uint(fixture.spec.players);
+    static const char* words[] = {"support", "attack", "hold", "convoy", "ally", "betray", "draw", "peace"};
+    std::vector<std::string> texts;
+    std::mt19937 rng(fixture.spec.seed);
+    for (int i = 0; i < 1024; i++) {
+        texts.push_back(std::string(words[rng() % 8]) + " T" + std::to_string(rng() % 1000) + " with P"
+            + std::to_string(1 + rng() % players) + " then " + words[rng() % 8]);
+    }
+
+    for (size_t messages : sizes) {
+        auto fill = [&](PressStore& store, PressIndex& index) {
+            for (uint t = 0; t < 1000; t++) index.addTerritoryName("T" + std::to_string(t), t);
+            for (uint p = 1; p <= players; p++) index.addPlayerName("P" + std::to_string(p), p);
+            return [&store, &index, &texts, players](size_t i) {
+                uint sender = 1 + uint(i % players);
+                uint recipient = i % 3 == 0 ? 0 : 1 + uint((i / 3) % players);
+                uint64_t seq = store.append(sender, recipient, uint(i / 1000), texts[i % texts.size()]);
+                index.add(seq, store.at(seq));
+            };
+        };
+        {
+            PressStore store;
+            PressIndex index;
+            auto insert = fill(store, index);
+            size_t next = 0;
+            runBench("pressInsert", fixture, messages, [&](size_t) { insert(next++); });
+        }
+        PressStore store;
+        PressIndex index;
+        auto insert = fill(store, index);
+        for (size_t i = 0; i < messages; i++) insert(i);
+        runBench("pressQuery", fixture, 1000, [&](size_t i) {
+            PressQuery query;
+            query.words.push_back(words[i % 8]);
+            query.mentioned = 1 + int(i % players);
+            keep(index.query(query).size());
+        });
+        size_t next = messages;
+        runBench("pressUnread", fixture, 10000, [&](size_t) {
+            insert(next++);
+            keep(store.unread(1).size());
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+Scaling benchmark: load time, memory and adjudication time versus map size.
+
+Usage:
+`scalingBench ($territories ...)`, default 100 1000 10000 100000
+Output is one JSON object per line (std output), e.g.
+`{"bench":"scaling","territories":1000,"players":7,"loadMs":12.3,"rssKb":4512,"adjudicateMs":1.2}`
+rssKb is the resident memory the loaded game added. The game logs to the fixture's log.json,
+which is removed with the fixture.
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/scalingBench.cpp -o scalingBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {100, 1000, 10000, 100000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        FixtureDirectory inFixture(fixture);
+
+        long before = residentKb();
+        auto start = std::chrono::steady_clock::now();
+        Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+        game.initialize();
+        double loadMs = millisecondsSince(start);
+        long rssKb = residentKb() - before;
+
+        for (const std::string& order : fixture.moveOrders) {
+            game.command(order);
+        }
+        start = std::chrono::steady_clock::now();
+        game.adjudicate();
+        double adjudicateMs = millisecondsSince(start);
+
+        std::cout << json{{"bench", "scaling"}, {"territories", territories}, {"players", fixture.spec.players},
+            {"loadMs", loadMs}, {"rssKb", rssKb}, {"adjudicateMs", adjudicateMs}}.dump() << std::endl;
+    }
+    return 0;
+}
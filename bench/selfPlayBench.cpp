@@ -0,0 +1,36 @@
+/*
+Self-play throughput benchmark: one operation is a full phase in which every player submits a
+random legal order per unit (seeded, so runs repeat) and the phase is adjudicated.
+
+Usage:
+`selfPlayBench ($territories ...)`, default 100 1000
+Output format is described in benchCommon.h, bench "selfPlay"; nsPerOp is per phase.
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/selfPlayBench.cpp -o selfPlayBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {100, 1000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        FixtureDirectory inFixture(fixture);
+        {
+            Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+            game.initialize();
+            std::mt19937 rng(fixture.spec.seed);
+            std::vector<std::string> names;
+            for (size_t p = 1; p <= fixture.spec.players; p++) names.push_back("P" + std::to_string(p));
+            runBench("selfPlay", fixture, 10, [&](size_t) {
+                for (const std::string& name : names) {
+                    for (const std::string& order : randomOrders(game.legalOrders(game.player(name)), rng)) {
+                        game.command("diplomacy --order " + name + " " + order);
+                    }
+                }
+                game.adjudicate();
+            });
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+State hashing benchmark: Game::stateHash over the opening position.
+
+Usage:
+`stateHashBench ($territories ...)`, default 1000 10000 100000
+Output format is described in benchCommon.h, bench "stateHash".
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN bench/stateHashBench.cpp -o stateHashBench`
+*/
+
+#include "benchCommon.h"
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = sizesFrom(argc, argv, {1000, 10000, 100000});
+    for (size_t territories : sizes) {
+        Fixture fixture(territories, std::max<size_t>(7, territories / 50));
+        Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+        game.initialize();
+        runBench("stateHash", fixture, std::max<size_t>(10, 1000000 / territories), [&](size_t) {
+            keep(game.stateHash());
+        });
+    }
+    return 0;
+}
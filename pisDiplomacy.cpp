@@ -51,6 +51,9 @@ e.g.
   "buildTime": "how many phases once buildPhase",
   "voteShown": "0 for not, 1 for yes",
   "drawType": "DSS, equal split for draws, or SoS, weighted split on draw",
+  "moveDeadline": "seconds allowed for a move phase, 0 or absent for no deadline",
+  "retreatDeadline": "seconds allowed for a retreat phase, 0 or absent for no deadline",
+  "buildDeadline": "seconds allowed for a build phase, 0 or absent for no deadline"
 }
 ```
 e.g.
@@ -60,11 +63,15 @@ e.g.
   "buildRule": "initCenters",
   "buildTime": 4,
   "voteShown": 1,
-  "drawType": DSS
+  "drawType": DSS,
+  "moveDeadline": 86400,
+  "retreatDeadline": 3600,
+  "buildDeadline": 3600
 }
 ```
 
-"log.json" format ($ prefix indicates variables, () indicates comments, log at end of every phase):
+"log.json" format ($ prefix indicates variables, () indicates comments, log at end of every phase,
+the file is created empty when the game starts):
 ```
 {
   "Phase $phaseCount $phaseType (move/build/retreat)": {
@@ -89,22 +96,48 @@ e.g.
 }
 ```
 
+"network.json" format (policy/value network for InferenceNetwork, weights as rows of inputs per output):
+```
+{
+  "features": "per part input features, Game::partFeatures",
+  "layers": [
+    {"type": "graphConv", "self": [[w, ...], ...], "neighbor": [[w, ...], ...], "bias": [b, ...], "activation": "relu"},
+    {"type": "meanPool"},
+    {"type": "dense", "weights": [[w, ...], ...], "bias": [b, ...], "activation": "none"}
+  ]
+}
+```
+graphConv maps every part from its own features and the mean of its neighbors' (self and neighbor),
+meanPool averages over parts, dense applies to every part before meanPool and to the pooled vector after
+
 Order input format (std input):
 `diplomacy --order $playerName $partName M (move)/S (support hold)/V (via convoy)/R (retreat) to $partName`
 `diplomacy --order $playerName H (hold)/B (build)/D (disband) $partName`
 `diplomacy --order $playerName $partName S (support move)/C (convoy) to $partName from $partName`
 
+Ready input format (std input):
+`diplomacy --ready $playerName 1`
+1 for ready, 0 for not ready, the phase is adjudicated as soon as every player is ready
+
+Bot input format (std input):
+`diplomacy --bot $playerName ($milliseconds)`
+in a move phase, beam search picks and submits an order for every unit of the player, stopping
+after $milliseconds if given and always 500ms before the phase deadline; units it did not reach hold
+output `$playerName $order` for each, orders in log.json format, then
+`{"nodes": $n, "nodesPerSecond": $rate, "complete": true/false}`
+
 Draw vote input format (std input):
-`diplomacy --draw 1`
+`diplomacy --draw $playerName 1`
 1 for voting draw, 0 for cancelling draw
 
 Press input format (std input):
 `diplomacy --press $playerName $playerName $message`
 `diplomacy --press $playerName public $message`
-send from first playerName to second playerName
+send from first playerName to second playerName; bytes that are not valid UTF-8 are stored as U+FFFD
 
 Map output format (std output, output at end of every phase or if asked with `diplomacy --map`):
-output the map JSON file
+output the map JSON file with the state at the end of the last phase
+`{"map": $mapJson, "phase": "Phase $phaseCount $phaseType", "owners": {"$territoryName": "$playerName"}, "units": {"$playerName": ["$partName"]}}`
 
 Rules output format (std output, output if asked with `diplomacy --rules`):
 output the rules JSON file
@@ -117,25 +150,474 @@ Build phase:
 Retreat phase:
 `$playerName retreat $partName (, $partName2)`
 
+Result output format (std output, output when the game ends):
+`Result solo $playerName`
+`Result draw $playerName $share ...`
+shares are equal (DSS) or by centers squared (SoS); with voteShown `$playerName vote 1/0` is output after every phase
+
+Press search input format (std input, any combination of terms, all must match):
+`diplomacy --search $word territory=$territoryName mentions=$playerName between=$playerName,$playerName phases=$from-$to`
+output `Phase $phase $playerName -> $playerName/public: $message` for every match in send order
+
+DAIDE bots (localhost TCP, binary DAIDE messages, served by DaideServer):
+powers and provinces use the first 3 characters of their names, orders are stored in log.json format,
+GOF sets ready and DRW votes draw, press sent with SND is stored as text with tokens by name
+
+Stats output format (std output, output if asked with `diplomacy --stats`):
+`{"topology": $bytes, "state": $bytes, "press": $bytes, "log": $bytes, "orders": $bytes, "reserved": $bytes}`
+live bytes per category, reserved is everything the game's arena holds from the system
+
+Latency output format (std output, output if asked with `diplomacy --latency`):
+`{"$section": {"count": $n, "p50": $ns, "p90": $ns, "p99": $ns, "max": $ns}}`
+sections are move, retreat, build, votes, map and log
+
+Allocations output format (std output, output if asked with `diplomacy --allocations`, counted only in
+builds with -DPIS_COUNT_ALLOCATIONS):
+`{"$section": {"calls": $n, "allocations": $n, "bytes": $bytes, "maxPerCall": $n}}`
+global heap allocations made on the calling thread; sections are adjudicate (whole phase change),
+phase (the phase's own resolution), order (validating and storing one order) and legalOrders
+
+Trace input format (std input):
+`diplomacy --trace 1`
+1 starts a new trace of spans (adjudicate, phases, log flush, press spill, commands, bot search, DAIDE I/O), 0 stops
+`diplomacy --trace $fileName`
+writes the spans recorded by every thread since the trace started or the last write as Chrome trace-event JSON,
+viewable in Perfetto; each thread keeps up to 65536 spans per trace and counts the rest as dropped
+
 Press output format (std output, output if asked with `diplomacy --press $playerName/public`):
 `$playerName/public: $message`
+only messages not yet shown to that player (or to spectators for public) are output
 */
 
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <functional>
+#include <future>
+#include <sstream>
+#include <cstring>
+#include <ctime>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <nlohmann/json.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using json = nlohmann::json;
 
+class Territory;
+class Player;
+
+// Hashed hierarchical timing wheel, one per hosting thread, shared by every game it drives.
+// Timers are intrusive list nodes so schedule and cancel are O(1); advance() cascades
+// higher levels down as the lowest level wraps.
+class TimerWheel {
+public:
+    struct Timer {
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        uint64_t expires = 0; // in ticks
+        std::function<void()> callback;
+        bool pending() const { return prev != nullptr; }
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds tick);
+    void schedule(Timer& timer, std::chrono::milliseconds delay);
+    void cancel(Timer& timer);
+    void advance(std::chrono::steady_clock::time_point now); // fire every timer expired by now
+
+private:
+    static constexpr int slotBits = 6;
+    static constexpr uint64_t slotCount = 1 << slotBits;
+    static constexpr int levelCount = 4; // 64^4 ticks per rotation, longer delays are re-placed
+    std::chrono::milliseconds tick;
+    std::chrono::steady_clock::time_point start;
+    uint64_t current; // ticks since start
+    Timer slots[levelCount][slotCount]; // list heads
+    void place(Timer& timer);
+    void cascade(int level);
+};
+
+// Vyukov's intrusive multi-producer single-consumer queue. push() is a single atomic
+// exchange from any thread and never blocks; pop() runs only on the consuming thread.
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(&stub), tail(&stub) {}
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {}
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        link(new Node{std::move(value), {nullptr}});
+    }
+
+    // Returns false when empty, or when a producer is between its exchange and link.
+    bool pop(T& value) {
+        Node* first = tail;
+        Node* next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (!next) return false;
+            tail = first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (!next) {
+            if (first != head.load(std::memory_order_acquire)) return false;
+            stub.next.store(nullptr, std::memory_order_relaxed);
+            link(&stub);
+            next = first->next.load(std::memory_order_acquire);
+            if (!next) return false;
+        }
+        tail = next;
+        value = std::move(first->value);
+        delete first;
+        return true;
+    }
+
+private:
+    struct Node {
+        T value;
+        std::atomic<Node*> next;
+    };
+    Node stub{T(), {nullptr}};
+    std::atomic<Node*> head; // last pushed, shared by producers
+    Node* tail; // next to pop, consumer only
+
+    void link(Node* node) {
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+};
+
+// Vector of trivially copyable values keeping the first N inline, so typical sizes need no
+// heap allocation and sit next to the rest of their owner. Spills to the heap past N.
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector holds trivially copyable values");
+
+public:
+    SmallVector() = default;
+    SmallVector(const SmallVector& other) { assign(other); }
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            clear();
+            assign(other);
+        }
+        return *this;
+    }
+    ~SmallVector() { release(); }
+
+    T* begin() { return data; }
+    T* end() { return data + count; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + count; }
+    size_t size() const { return count; }
+    size_t capacity() const { return limit; }
+    size_t heapCapacity() const { return data == local ? 0 : limit; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) { return data[i]; }
+    const T& operator[](size_t i) const { return data[i]; }
+    T& back() { return data[count - 1]; }
+
+    void push_back(T value) {
+        if (count == limit) reserve(limit * 2);
+        data[count++] = value;
+    }
+    T* erase(T* position) {
+        std::memmove(position, position + 1, (end() - position - 1) * sizeof(T));
+        count--;
+        return position;
+    }
+    void clear() { count = 0; }
+    void reserve(size_t wanted) {
+        if (wanted <= limit) return;
+        T* grown = static_cast<T*>(::operator new(wanted * sizeof(T)));
+        std::memcpy(grown, data, count * sizeof(T));
+        release();
+        data = grown;
+        limit = wanted;
+    }
+
+private:
+    T local[N];
+    T* data = local;
+    size_t count = 0;
+    size_t limit = N;
+
+    void release() {
+        if (data != local) ::operator delete(data);
+    }
+    void assign(const SmallVector& other) {
+        reserve(other.count);
+        std::memcpy(data, other.data, other.count * sizeof(T));
+        count = other.count;
+    }
+};
+
+// HDR-style histogram of nanosecond latencies: 16 linear sub-buckets per power of two, so
+// every recorded value keeps about 6% precision. Recording is one relaxed atomic add.
+class LatencyHistogram {
+public:
+    void record(uint64_t nanoseconds) {
+        buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = maximum.load(std::memory_order_relaxed);
+        while (nanoseconds > seen && !maximum.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {}
+    }
+    uint64_t count() const {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets) total += bucket.load(std::memory_order_relaxed);
+        return total;
+    }
+    uint64_t max() const { return maximum.load(std::memory_order_relaxed); }
+    uint64_t percentile(double fraction) const {
+        uint64_t total = count();
+        uint64_t rank = uint64_t(fraction * double(total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucketCount; i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (total && seen > rank) return std::min(upperBound(i), max());
+        }
+        return max();
+    }
+
+private:
+    static constexpr int subBits = 4;
+    static constexpr size_t bucketCount = (64 - subBits + 1) << subBits;
+    std::atomic<uint64_t> buckets[bucketCount] = {};
+    std::atomic<uint64_t> maximum{0};
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < (uint64_t(1) << subBits)) return value;
+        int magnitude = 63 - __builtin_clzll(value) - subBits + 1;
+        return (size_t(magnitude) << subBits) + ((value >> (magnitude - 1)) & ((1 << subBits) - 1));
+    }
+    static uint64_t upperBound(size_t bucket) {
+        size_t magnitude = bucket >> subBits;
+        uint64_t sub = bucket & ((1 << subBits) - 1);
+        if (magnitude == 0) return sub;
+        return (((uint64_t(1) << subBits) | sub) + 1) << (magnitude - 1);
+    }
+};
+
+// Records the lifetime of the scope into a histogram.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() {
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Optional span recorder dumped as Chrome trace-event JSON (Perfetto, chrome://tracing).
+// Each thread appends to its own fixed buffer and publishes with one release store, so
+// recording never locks; spans past a full buffer are counted and dropped. While disabled
+// a span costs one relaxed load.
+class Tracer {
+public:
+    // Turning tracing on starts a new trace: every thread's buffer begins empty again.
+    static void enable(bool on) {
+        if (on) generation.fetch_add(1, std::memory_order_release);
+        enabled.store(on, std::memory_order_relaxed);
+    }
+    static bool active() { return enabled.load(std::memory_order_relaxed); }
+    static uint64_t now(); // nanoseconds since the first call
+    static void record(const char* name, uint64_t start, uint64_t end); // name must outlive the tracer
+    static void dump(std::ostream& out); // spans of the current trace by every thread, then starts a new one
+
+private:
+    struct Span {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+    struct Buffer {
+        uint thread;
+        std::unique_ptr<Span[]> spans{new Span[capacity]};
+        std::atomic<size_t> count{0};
+        std::atomic<size_t> dropped{0};
+        std::atomic<uint64_t> generation{0}; // the trace count and dropped belong to
+    };
+    static constexpr size_t capacity = 1 << 16;
+    static std::atomic<bool> enabled;
+    static std::atomic<uint64_t> generation; // of the current trace
+    static std::mutex registry; // guards buffers, taken once per thread and by dump
+    static std::vector<std::unique_ptr<Buffer>> buffers; // outlive their threads
+    static Buffer& local();
+};
+
+// Records the lifetime of the scope as a trace span when tracing is on.
+class ScopedTrace {
+public:
+    explicit ScopedTrace(const char* name)
+        : name(Tracer::active() ? name : nullptr), start(this->name ? Tracer::now() : 0) {}
+    ~ScopedTrace() {
+        if (name) Tracer::record(name, start, Tracer::now());
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+// Allocation counting mode, built with -DPIS_COUNT_ALLOCATIONS: global operator new counts
+// calls per thread, and an AllocScope charges what its own thread allocated during the scope
+// to an AllocationStats. Work handed to other threads is not charged. Without the flag
+// AllocScope is empty and every stats entry stays zero.
+struct AllocationStats {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> maxPerCall{0}; // allocations
+};
+
+#ifdef PIS_COUNT_ALLOCATIONS
+struct ThreadAllocations {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+thread_local ThreadAllocations threadAllocations;
+
+void* operator new(size_t bytes) {
+    threadAllocations.allocations++;
+    threadAllocations.bytes += bytes;
+    if (void* memory = std::malloc(bytes ? bytes : 1)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new(size_t bytes, std::align_val_t alignment) {
+    threadAllocations.allocations++;
+    threadAllocations.bytes += bytes;
+    void* memory = nullptr;
+    if (posix_memalign(&memory, std::max(size_t(alignment), sizeof(void*)), bytes ? bytes : 1) == 0) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t bytes) { return operator new(bytes); }
+void* operator new[](size_t bytes, std::align_val_t alignment) { return operator new(bytes, alignment); }
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept {
+    try { return operator new(bytes); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept {
+    try { return operator new(bytes); } catch (...) { return nullptr; }
+}
+// Kept out of line so GCC does not pair the inlined free() with operator new at call sites.
+__attribute__((noinline)) void operator delete(void* memory) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete(void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+__attribute__((noinline)) void operator delete[](void* memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+#endif
+
+class AllocScope {
+public:
+#ifdef PIS_COUNT_ALLOCATIONS
+    explicit AllocScope(AllocationStats& stats) : stats(stats), start(threadAllocations) {}
+    ~AllocScope() {
+        uint64_t allocations = threadAllocations.allocations - start.allocations;
+        stats.calls.fetch_add(1, std::memory_order_relaxed);
+        stats.allocations.fetch_add(allocations, std::memory_order_relaxed);
+        stats.bytes.fetch_add(threadAllocations.bytes - start.bytes, std::memory_order_relaxed);
+        uint64_t seen = stats.maxPerCall.load(std::memory_order_relaxed);
+        while (allocations > seen && !stats.maxPerCall.compare_exchange_weak(seen, allocations, std::memory_order_relaxed)) {}
+    }
+
+private:
+    AllocationStats& stats;
+    ThreadAllocations start;
+#else
+    explicit AllocScope(AllocationStats&) {}
+#endif
+};
+
+// Forwards to an upstream resource and keeps live and peak byte counts, readable from any thread.
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+    size_t bytes() const { return live.load(std::memory_order_relaxed); }
+    size_t peak() const { return high.load(std::memory_order_relaxed); }
+
+private:
+    std::pmr::memory_resource* upstream;
+    std::atomic<size_t> live{0};
+    std::atomic<size_t> high{0};
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = upstream->allocate(bytes, alignment);
+        size_t now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t seen = high.load(std::memory_order_relaxed);
+        while (now > seen && !high.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {}
+        return memory;
+    }
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        upstream->deallocate(memory, bytes, alignment);
+        live.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Fixed set of worker threads shared by every game on the host.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()));
+    ~ThreadPool();
+    size_t size() const { return workers.size(); }
+    // Runs body(0..count-1) across the workers and the calling thread, returning when all are done.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+};
+
 class Part {
 public:
     std::string name;
-    std::vector<Part*> neighbors;
+    uint id; // index in allParts
+    SmallVector<Part*, 8> neighbors;
     Territory* belonged;
     unsigned char LC; // 0 for land, 1 for coast
     Player* unit;
@@ -144,6 +626,7 @@ public:
 class Territory {
 public:
     std::string name;
+    uint id; // index in allTerritories
     std::vector<std::unique_ptr<Part>> parts;
     unsigned char center; // 0 for not, 1 for yes
     Player* owner;
@@ -152,142 +635,3454 @@ public:
 class Player {
 public:
     std::string name;
-    std::vector<Territory*> allowBuild;
+    uint id; // index in allPlayers
+    SmallVector<Territory*, 4> allowBuild;
     int centerCount;
     int unitCount;
-    std::vector<Part*> units;
+    SmallVector<Part*, 18> units;
+    std::pmr::vector<std::pmr::string> orders; // this phase, in log.json format
     bool vote;
-    bool ready;
+    std::atomic<bool> ready;
+    explicit Player(std::pmr::memory_resource* resource) : orders(resource) {}
+};
+
+// Per part and player: how many of the player's units could move into the part next phase
+// (threat), and how many could move into some part of its territory and so support into it
+// (support). Placing or lifting a unit updates only the parts around it; nothing is
+// recomputed from Player::units. Convoyed moves are not counted.
+class InfluenceMap {
+public:
+    struct Entry {
+        uint player; // index in allPlayers
+        uint16_t threat;
+        uint16_t support;
+    };
+    void reset(size_t parts) { entries.assign(parts, {}); }
+    void place(const Part* unit, uint player) { update(unit, player, 1); }
+    void lift(const Part* unit, uint player) { update(unit, player, -1); }
+    int threat(const Part* part, uint player) const;
+    int support(const Part* part, uint player) const;
+    const SmallVector<Entry, 4>& at(const Part* part) const { return entries[part->id]; } // players with any influence
+    size_t bytes() const;
+
+private:
+    std::vector<SmallVector<Entry, 4>> entries; // by part id
+    void update(const Part* unit, uint player, int delta);
+    Entry& entry(const Part* part, uint player);
+    void prune(const Part* part);
+};
+
+// Territories a unit in each part could support into, which are exactly those it could move
+// into: the army's row for a land part, the fleet's for a coast part, each split coast its own.
+// Rows are bitsets over territory ids, so checking a support is one bit test; above
+// denseLimit territories the rows would not fit and become sorted territory lists instead.
+class SupportTable {
+public:
+    void build(const std::vector<Part*>& parts, size_t territories);
+    bool canSupport(const Part* supporter, const Territory* target) const;
+    size_t bytes() const;
+
+private:
+    static constexpr size_t denseLimit = 4096;
+    size_t words = 0; // per row, 0 for sorted lists
+    std::vector<uint64_t> bits; // by part id * words
+    std::vector<uint> offsets; // by part id, into lists
+    std::vector<uint> lists;
+};
+
+// Part adjacency in compressed rows: part i's neighbors are neighbors[offsets[i]..offsets[i + 1]).
+struct PartGraph {
+    std::vector<uint> offsets;
+    std::vector<uint> neighbors;
+};
+
+struct PressMessage {
+    uint sender; // index in allPlayers
+    uint recipient; // index in allPlayers, 0 for public
+    uint phase; // phaseCount when sent
+    std::pmr::string text;
+};
+
+// Messages are immutable once sent; every queue holding one shares the same buffer.
+using PressRef = std::shared_ptr<const PressMessage>;
+
+// Push-side delivery for live connections: a public message is enqueued by reference
+// into every subscriber, a private one only into its recipient's subscribers.
+struct PressSubscriber {
+    uint recipient; // index in allPlayers, 0 for spectators
+    std::deque<PressRef> queue;
+};
+
+// Append-only press log cut into fixed-size segments. Messages are numbered in send order;
+// each channel (sender/recipient pair, or public) and each recipient's inbox lists those
+// numbers, and every recipient keeps read cursors so fetching new press is O(new messages).
+// Segments everyone has read can be spilled to a file and are reloaded on demand.
+class PressStore {
+public:
+    static constexpr size_t segmentSize = 256;
+    explicit PressStore(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    uint64_t append(uint sender, uint recipient, uint phase, std::string_view text);
+    const PressMessage& at(uint64_t seq);
+    const std::pmr::vector<uint64_t>& channel(uint sender, uint recipient) const;
+    std::vector<uint64_t> unread(uint recipient); // private and public messages, advances the cursors
+    uint64_t size() const { return count; }
+    uint64_t readFloor() const; // every message below has been read by every tracked player
+    void track(uint recipient); // counts the recipient in readFloor before it first reads
+    void spill(uint64_t before, const std::string& path);
+    void subscribe(PressSubscriber& subscriber);
+    void unsubscribe(PressSubscriber& subscriber);
+
+private:
+    struct Segment {
+        std::pmr::vector<PressRef> messages;
+        bool spilled = false;
+        std::streamoff offset = -1; // position in the spill file once written
+        explicit Segment(std::pmr::memory_resource* resource) : messages(resource) {}
+    };
+    std::pmr::memory_resource* resource;
+    std::pmr::vector<std::unique_ptr<Segment>> segments;
+    uint64_t count = 0;
+    std::pmr::unordered_map<uint64_t, std::pmr::vector<uint64_t>> channels; // sender << 32 | recipient
+    std::pmr::vector<uint64_t> publicChannel;
+    std::pmr::vector<std::pmr::vector<uint64_t>> inboxes; // private messages per recipient
+    std::pmr::vector<size_t> inboxCursor;
+    std::pmr::vector<size_t> publicCursor;
+    PressRef make(uint sender, uint recipient, uint phase, std::string_view text);
+    std::string spillPath;
+    std::vector<PressSubscriber*> subscribers;
+};
+
+struct PressQuery {
+    std::vector<std::string> words; // lower case
+    int territory = -1; // index in allTerritories mentioned, -1 for any
+    int mentioned = -1; // index in allPlayers mentioned, -1 for any
+    int between[2] = {-1, -1}; // sent either way between two players, -1 for any
+    uint fromPhase = 0;
+    uint toPhase = UINT_MAX;
+};
+
+// Inverted index over press, extended as each message arrives. Words, mentioned territories
+// (by territory or part name), mentioned players and player pairs map to sorted lists of
+// message numbers; phases map to the first message number sent in them.
+class PressIndex {
+public:
+    explicit PressIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    void addTerritoryName(const std::string& name, uint territory);
+    void addPlayerName(const std::string& name, uint player);
+    void add(uint64_t seq, const PressMessage& message);
+    std::vector<uint64_t> query(const PressQuery& query) const;
+
+private:
+    std::pmr::unordered_map<std::pmr::string, std::pmr::vector<uint64_t>> words;
+    std::pmr::unordered_map<std::pmr::string, uint> territoryNames;
+    std::pmr::unordered_map<std::pmr::string, uint> playerNames;
+    std::pmr::vector<std::pmr::vector<uint64_t>> territories;
+    std::pmr::vector<std::pmr::vector<uint64_t>> players;
+    std::pmr::unordered_map<uint64_t, std::pmr::vector<uint64_t>> pairs; // lower id << 32 | higher id
+    std::pmr::vector<std::pair<uint, uint64_t>> phaseStarts;
+    uint64_t count = 0;
+};
+
+// Board state as of the end of a phase. Never modified after publishing, so a spectator
+// holding one reads it while the game moves on; only fetching it takes a short lock.
+struct StateSnapshot {
+    uint phaseCount;
+    unsigned char phaseType;
+    std::string phase; // phase output
+    std::shared_ptr<const std::string> mapText; // the map file, shared by every snapshot
+    std::string board; // the rest of the map output: phase, owners and units
+    std::string result; // vote and result output, empty when there is none
+    void writeMap(std::ostream& out) const { out << "{\"map\":" << *mapText << board; }
+};
+
+// Orders that can only affect each other: adjudicated together, independently of other regions.
+struct Region {
+    std::vector<Territory*> territories;
+    std::vector<const std::pmr::string*> orders;
+};
+
+// What a region's adjudication decided, applied to the board after every region is resolved,
+// plus the resolver's working space. A Resolution reused phase after phase keeps its
+// capacity, so resolving stops allocating once the vectors have grown.
+struct Resolution {
+    std::vector<std::pair<Part*, Part*>> moves; // unit moved from, to
+    std::vector<Part*> dislodged;
+    std::vector<Territory*> attackedFrom; // by index in dislodged: the attacker's territory, nullptr if convoyed
+    std::vector<Territory*> standoffs; // left empty by moves that bounced there
+
+    struct Unit {
+        Part* part;
+        char order; // H, M, V (convoyed move), S or C
+        Part* target; // destination of a move, support or convoy; the supported unit for support hold
+        Part* origin; // supported mover for support move, army for convoy
+        int other; // matching supported or convoyed unit, -1 if the order is void
+        bool attacks; // M, or V with a convoy route
+        bool cut;
+        bool dislodged;
+        bool clearIfLeft; // the move beats every rival if the target's unit leaves
+        unsigned char status; // moves only: 0 unresolved, 1 succeeds, 2 fails
+        unsigned char mark; // route search and ring walks
+    };
+    std::vector<Unit> units;
+    std::vector<std::pair<uint, uint>> unitAt; // territory id, unit
+    std::vector<std::pair<uint, uint>> arrivals; // territory id moved into, mover
+    std::vector<std::pair<uint, uint>> backing; // supported unit, supporter
+    std::vector<std::pair<uint, uint>> convoys; // army, fleet
+    std::vector<uint> route;
 };
 
 class Game {
 private:
+    // Per-game containers draw from a pool over a monotonic arena: freed blocks are reused
+    // within the game and everything goes back upstream in one release when the game ends.
+    // Declared first so it outlives every container using it. Each category draws through
+    // its own counter for --stats.
+    CountingResource reserved{std::pmr::new_delete_resource()};
+    std::pmr::monotonic_buffer_resource arena{&reserved};
+    std::pmr::unsynchronized_pool_resource arenaPool{&arena};
+    CountingResource pressMemory{&arenaPool};
+    CountingResource logMemory{&arenaPool};
+    CountingResource ordersMemory{&arenaPool};
     std::vector<std::unique_ptr<Territory>> allTerritories;
     std::vector<std::unique_ptr<Player>> allPlayers;
-    std::vector<std::tuple<std::weak_ptr<Player>,std::weak_ptr<Player>,std::string>> press; // allPlayer[0] for public, with name "public"
+    std::vector<Part*> allParts;
+    // Keys view the names owned by the objects themselves, built once in Game::Game.
+    std::unordered_map<std::string_view, Territory*> territoryByName;
+    std::unordered_map<std::string_view, Part*> partByName;
+    std::unordered_map<std::string_view, Player*> playerByName;
+    PressStore press{&pressMemory}; // allPlayer[0] for public, with name "public"
+    PressIndex pressIndex{&pressMemory};
     uint winCondition;
     unsigned char buildRule; // 0 for initTerritories, 1 for allTerritories
     uint buildTime;
     bool voteShown;
     unsigned char drawType; // 0 for DSS, 1for SoS
     uint phaseCount; // Retreat phase not counted
-    std::string log;
+    unsigned char phaseType; // 0 for move, 1 for retreat, 2 for build
+    uint phaseDeadline[3]; // seconds for move/retreat/build, 0 for no deadline
+    std::chrono::steady_clock::time_point phaseEnds; // when the deadline timer fires, max() without one
+    TimerWheel* wheel;
+    TimerWheel::Timer deadline;
+    std::atomic<int> notReady; // players still to set ready this phase, readable from any thread
+    MpscQueue<std::string> commands; // submitted from any thread, run by the game's owner thread
+    ThreadPool* pool;
+    size_t parallelThreshold; // fewer units than this adjudicate on the game's own thread
+    bool partitioned; // false resolves the whole board as one region, the reference for checks
+    std::vector<std::pair<Part*, Player*>> dislodgedUnits; // waiting to retreat
+    std::vector<Territory*> dislodgedFrom; // by index in dislodgedUnits, see Resolution::attackedFrom
+    std::vector<Territory*> standoffs; // of the last move phase, closed to retreats
+    bool finished = false; // won or drawn
+    std::string verdict; // vote and result output of the last phase
+    std::shared_ptr<const StateSnapshot> published; // see snapshot()
+    enum LatencySection { moveLatency, retreatLatency, buildLatency, votesLatency, mapLatency, logLatency, latencySections };
+    LatencyHistogram latency[latencySections];
+    enum AllocationSection { adjudicateAllocations, phaseAllocations, orderAllocations, legalOrdersAllocations, allocationSections };
+    mutable AllocationStats allocations[allocationSections];
+    // Move phase scratch, kept across phases so steady-state resolution does not allocate.
+    std::vector<uint> regionParent;
+    std::vector<int> regionOf;
+    std::vector<Region> regions; // first regionCount are this phase's
+    size_t regionCount = 0;
+    std::vector<Resolution> resolutions;
+    std::vector<Player*> movers;
+    InfluenceMap influence;
+    SupportTable supports;
+    std::pmr::string log{&logMemory};
     std::string logFilePath;
-    std::string mapRaw;
+    uint loggedPhases; // entries written to the log file by this game
+    std::string pressFilePath;
+    std::shared_ptr<const std::string> mapRaw; // shared with every snapshot
     std::string rulesRaw;
     void movePhase();
+    void orderRegions();
+    void resolveMoves(const Region& region, Resolution& resolution) const;
+    void applyResolution(const Resolution& resolution);
+    // Every change to the board goes through these so the influence map stays current.
+    void placeUnit(Part* part, Player* player);
+    Player* liftUnit(Part* part);
+    void finishMovement();
+    void updateCenters();
+    bool canRetreat(size_t dislodged, const Part* target) const;
     void retreatPhase();
     void buildPhase();
     void checkVotes();
+    void resetReady();
+    void publishSnapshot();
+    void writeLog();
+    Player* findPlayer(std::string_view playerName) const;
+    Part* findPart(std::string_view partName) const;
+    Territory* findTerritory(std::string_view territoryName) const;
+    void linkNeighbors(const json& mapJson);
+    friend class DaideServer;
+    friend class BeamSearchBot;
 
 public:
-    Game(const std::string& mapPath, const std::string& rulesPath);
+    Game(const std::string& mapPath, const std::string& rulesPath, const std::string& logPath = "log.json");
+    ~Game();
     void initialize();
     void play();
+    void attachTimer(TimerWheel& timerWheel);
+    void attachPool(ThreadPool& threadPool, size_t threshold = 256);
+    void partitionRegions(bool enabled) { partitioned = enabled; }
+    void adjudicate();
+    void command(const std::string& line);
+    void submit(std::string line) { commands.push(std::move(line)); }
+    void drain();
+    json memoryStats() const;
+    json latencyStats() const;
+    json allocationStats() const;
+    const Player* player(std::string_view playerName) const { return findPlayer(playerName); }
+    std::vector<std::string> legalOrders(const Player* player) const;
+    uint64_t stateHash() const;
+    const InfluenceMap& influenceMap() const { return influence; }
+    static constexpr size_t partFeatures = 8;
+    std::vector<float> encodeParts(const Player* power) const; // partFeatures per part, by part id
+    PartGraph partGraph() const;
+    // The shared_ptr atomics take a short lock from the library's mutex pool, held only to copy
+    // or swap the pointer, never while a phase is rendered.
+    std::shared_ptr<const StateSnapshot> snapshot() const { return std::atomic_load_explicit(&published, std::memory_order_acquire); }
+    void setReady(Player* player, bool ready);
+    void setVote(Player* player, bool vote);
+    void submitOrder(Player* player, const std::string& order);
+    uint64_t sendPress(Player* sender, Player* recipient, std::string_view message);
+    bool allReady() const { return notReady.load(std::memory_order_acquire) == 0; }
+    void subscribePress(PressSubscriber& subscriber) { press.subscribe(subscriber); }
+    void unsubscribePress(PressSubscriber& subscriber) { press.unsubscribe(subscriber); }
 };
 
-Game::Game(const std::string& mapPath, const std::string& rulesPath) {
-    std::ifstream mapFile(mapPath);
-    std::ifstream rulesFile(rulesPath);
-    
-    if (!mapFile || !rulesFile) {
-        throw std::runtime_error("Failed to open input files");
+// Limits for one search, checked before every node (one adjudicated candidate). When any is
+// hit the search stops and returns the best complete order set found so far.
+struct SearchBudget {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    std::chrono::nanoseconds cpu = std::chrono::nanoseconds::max(); // summed over every searching thread
+    const std::atomic<bool>* cancel = nullptr; // set from any thread to stop early
+};
+
+struct SearchResult {
+    std::vector<std::string> orders; // one per unit, in log.json format
+    uint64_t nodes = 0;
+    double seconds = 0;
+    double nodesPerSecond = 0;
+    bool complete = false; // false if the budget cut the search short
+};
+
+struct BeamOptions {
+    size_t width = 8; // order sets kept after each unit
+    size_t samples = 4; // opponent order sets every candidate is scored against
+    size_t candidatesPerUnit = 12; // hold and moves first, then supports and convoys
+    uint32_t seed = 1; // opponent sampling
+};
+
+// Move phase bot that builds a power's order set one unit at a time, most threatened unit
+// first. Each partial set (later units holding) is adjudicated with resolveMoves against the
+// same sampled opponent orders and scored by a heuristic; the best `width` survive to the
+// next unit. Candidates are scored in parallel on the game's pool when it has one. Only the
+// territories within two moves of the power's units take part. The search is anytime: the
+// best set so far, with every undecided unit holding, is always complete.
+class BeamSearchBot {
+public:
+    explicit BeamSearchBot(const Game& game) : game(game) {}
+    SearchResult search(const Player* power, const BeamOptions& options = BeamOptions(),
+        const SearchBudget& budget = SearchBudget()) const;
+    // Budget ending `margin` before the game's phase deadline, unbounded without one.
+    SearchBudget phaseBudget(std::chrono::milliseconds margin = std::chrono::milliseconds(500)) const;
+
+private:
+    const Game& game;
+    double evaluate(const Player* power, const Resolution& resolution) const;
+};
+
+// One fully connected transform, out = in * weights^T + bias, over many rows at once. Weights
+// are stored input-major and walked in blocks of 64 outputs that stay in cache while every
+// input row passes, so batching positions loads each weight once per batch; the block's sums
+// live in registers. quantize() switches to int8 weights with a scale per output, kept as
+// int16 input pairs for multiply-add; inputs are then quantized per row on the fly. On x86
+// full blocks use AVX2 kernels when the CPU has AVX2 and FMA, whatever the build flags.
+class DenseWeights {
+public:
+    DenseWeights(size_t inputs, size_t outputs, std::vector<float> weights, std::vector<float> bias);
+    size_t inputs() const { return inputCount; }
+    size_t outputs() const { return outputCount; }
+    void quantize();
+    void apply(const float* in, size_t rows, float* out, bool accumulate) const; // out is rows x outputs
+
+private:
+    static constexpr size_t blockColumns = 64;
+    size_t inputCount;
+    size_t outputCount;
+    bool avx2; // the CPU runs the AVX2 kernels
+    std::vector<float> transposed; // inputs x outputs
+    std::vector<float> bias;
+    std::vector<int16_t> pairs; // (input pair, output, 2) int8 values, empty until quantize()
+    std::vector<float> scales;
+    void blockF32(const float* in, size_t first, size_t columns, float* sums) const;
+    void blockI8(const int16_t* in, size_t first, size_t columns, int32_t* sums) const;
+};
+
+// Small CPU inference runtime for policy/value networks over positions encoded with
+// Game::encodeParts. A batch of positions runs through every layer together; graph
+// convolutions turn it into one GEMM over batch x parts rows. evaluate() is const and safe to
+// call from several threads.
+class InferenceNetwork {
+public:
+    InferenceNetwork(const std::string& path, PartGraph graph);
+    void quantize(); // int8 weights for every layer
+    size_t inputSize() const { return (graph.offsets.size() - 1) * features; }
+    size_t outputSize() const { return outputs; }
+    void evaluate(const float* inputs, size_t batch, float* results) const; // positions back to back
+
+private:
+    struct Layer {
+        enum Kind { graphConv, dense, meanPool } kind;
+        std::unique_ptr<DenseWeights> self;
+        std::unique_ptr<DenseWeights> neighbor; // graphConv only
+        bool relu;
+    };
+    PartGraph graph;
+    size_t features;
+    size_t outputs; // per position
+    std::vector<Layer> layers;
+};
+
+// Merges evaluation requests from many games into batches for one network. A request waits
+// at most maxDelay for others to join; a full batch runs at once on the queue's own thread.
+class InferenceQueue {
+public:
+    InferenceQueue(const InferenceNetwork& network, size_t maxBatch = 64,
+        std::chrono::microseconds maxDelay = std::chrono::microseconds(2000));
+    ~InferenceQueue();
+    std::future<std::vector<float>> submit(std::vector<float> input); // network.inputSize() values
+
+private:
+    struct Request {
+        std::vector<float> input;
+        std::promise<std::vector<float>> result;
+        std::chrono::steady_clock::time_point arrived;
+    };
+    const InferenceNetwork& network;
+    size_t maxBatch;
+    std::chrono::microseconds maxDelay;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Request> pending;
+    bool stopping = false;
+    std::thread worker;
+    void run();
+};
+
+// Zero-copy view over a DAIDE diplomacy message: big-endian 16-bit tokens read straight
+// from the receive buffer, with bracketed groups addressed by token index. Every read is
+// bounds-checked and throws on a truncated message, which the server answers with HUH.
+class DaideTokens {
+public:
+    DaideTokens(const unsigned char* data, size_t count) : data(data), count(count) {}
+    size_t size() const { return count; }
+    uint16_t operator[](size_t i) const {
+        if (i >= count) throw std::out_of_range("DAIDE message too short");
+        return uint16_t(data[2 * i] << 8 | data[2 * i + 1]);
     }
-    
-    json mapJson = json::parse(mapFile);
-    json rulesJson = json::parse(rulesFile);
-    
-    mapRaw = mapJson.dump();
-    rulesRaw = rulesJson.dump();
-    
-    winCondition = rulesJson["winCondition"];
-    buildRule = (rulesJson["buildRule"] == "allCenters") ? 1 : 0;
-    buildTime = rulesJson["buildTime"];
-    voteShown = rulesJson["voteShown"] == 1;
-    drawType = (rulesJson["drawType"] == "DSS") ? 0 : 1;
-    phaseCount = 1;
-    logFilePath = "log.json";
-    
-    for (auto& [territoryName, territoryData] : mapJson.items()) {
-        auto territory = std::make_unique<Territory>();
-        territory->name = territoryName;
-        territory->center = territoryData["center"];
-        territory->owner = nullptr;
-        
-        for (auto& [partName, neighbors] : territoryData.items()) {
-            if (partName != "center" && partName != "initPlayer" && partName != "initPart") {
-                auto part = std::make_unique<Part>();
-                part->name = partName;
-                part->belonged = territory.get();
-                part->unit = nullptr;
-                part->LC = (partName.substr(partName.size()-1)=='C') ? 1 : 0;
-                territory->parts.push_back(std::move(part));
-            }
+    size_t skip(size_t at) const; // index after the token or bracketed group starting at `at`
+    DaideTokens group(size_t at) const; // inside of the bracketed group starting at `at`
+    DaideTokens slice(size_t from, size_t to) const {
+        if (from > to || to > count) throw std::out_of_range("DAIDE message too short");
+        return DaideTokens(data + 2 * from, to - from);
+    }
+
+private:
+    const unsigned char* data;
+    size_t count;
+};
+
+// DAIDE server on localhost TCP so third-party bots can play a Game directly. Powers and
+// provinces get custom tokens announced in the representation message; orders, press, ready
+// (GOF) and draw votes map onto Game's own entry points. poll() must run on the thread that
+// owns the game. Client sockets are non-blocking: replies queue per client and go out as the
+// socket takes them, so one slow reader never stalls the others.
+class DaideServer {
+public:
+    DaideServer(Game& game, uint16_t port);
+    ~DaideServer();
+    void poll(int timeoutMs);
+    void run();
+    void stop() { running = false; }
+
+private:
+    struct Client {
+        int socket;
+        Player* power; // nullptr until NME/IAM, public player for observers
+        bool started; // accepted the map and gets phase updates
+        std::vector<unsigned char> input;
+        std::vector<unsigned char> output; // queued until the socket takes it
+        PressSubscriber press;
+    };
+    static constexpr size_t outputLimit = 1 << 20; // a client this far behind is dropped
+    Game& game;
+    int listener;
+    std::atomic<bool> running;
+    std::vector<std::unique_ptr<Client>> clients;
+    std::vector<uint16_t> powerTokens; // by player id, [0] unused
+    std::vector<uint16_t> provinceTokens; // by index in allTerritories
+    std::unordered_map<uint16_t, Territory*> provinces;
+    std::unordered_map<uint16_t, std::string> tokenNames;
+    std::unordered_map<std::string, uint16_t> nameTokens;
+    uint lastPhaseCount;
+    unsigned char lastPhaseType;
+    void accept();
+    void drop(size_t index);
+    bool receive(Client& client);
+    bool flush(Client& client);
+    void handle(Client& client, DaideTokens message);
+    void send(Client& client, unsigned char type, const std::vector<uint16_t>& tokens);
+    void sendPhase(Client& client);
+    void sendMap(Client& client);
+    void forwardPress(Client& client);
+    std::string orderText(Player* power, DaideTokens order);
+    Part* partAt(DaideTokens tokens, size_t at, bool fleet);
+    std::vector<uint16_t> location(const std::string& name);
+    std::string render(DaideTokens tokens) const;
+    bool encode(std::string_view text, std::vector<uint16_t>& tokens) const;
+};
+
+std::atomic<bool> Tracer::enabled{false};
+std::atomic<uint64_t> Tracer::generation{0};
+std::mutex Tracer::registry;
+std::vector<std::unique_ptr<Tracer::Buffer>> Tracer::buffers;
+
+uint64_t Tracer::now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Tracer::Buffer& Tracer::local() {
+    thread_local Buffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(registry);
+        buffers.push_back(std::make_unique<Buffer>());
+        buffer = buffers.back().get();
+        buffer->thread = uint(buffers.size());
+    }
+    return *buffer;
+}
+
+// Only the owning thread writes a buffer, so it also empties it, on its first span of a new trace.
+void Tracer::record(const char* name, uint64_t start, uint64_t end) {
+    Buffer& buffer = local();
+    uint64_t current = generation.load(std::memory_order_acquire);
+    if (buffer.generation.load(std::memory_order_relaxed) != current) {
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation.store(current, std::memory_order_release);
+    }
+    size_t at = buffer.count.load(std::memory_order_relaxed);
+    if (at == capacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.spans[at] = {name, start, end};
+    buffer.count.store(at + 1, std::memory_order_release);
+}
+
+void Tracer::dump(std::ostream& out) {
+    json events = json::array();
+    std::lock_guard<std::mutex> lock(registry);
+    uint64_t current = generation.load(std::memory_order_acquire);
+    for (const auto& buffer : buffers) {
+        if (buffer->generation.load(std::memory_order_acquire) != current) continue; // nothing this trace
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->thread},
+            {"args", {{"name", "thread " + std::to_string(buffer->thread)}}}});
+        for (size_t i = 0; i < count; i++) {
+            const Span& span = buffer->spans[i];
+            events.push_back({{"name", span.name}, {"ph", "X"}, {"pid", 1}, {"tid", buffer->thread},
+                {"ts", double(span.start) / 1000}, {"dur", double(span.end - span.start) / 1000}});
+        }
+        size_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+        if (dropped) {
+            events.push_back({{"name", "dropped"}, {"ph", "C"}, {"pid", 1}, {"tid", buffer->thread},
+                {"ts", count ? double(buffer->spans[count - 1].end) / 1000 : 0.0}, {"args", {{"spans", dropped}}}});
         }
-        
-        allTerritories.push_back(std::move(territory));
     }
-    
-    std::unordered_map<std::string, Player*> playerMap;
-    auto publicPlayer = std::make_unique<Player>();
-    publicPlayer->name = "public";
-    publicPlayer->centerCount = 0;
-    publicPlayer->unitCount = 0;
-    publicPlayer->vote = true;
-    publicPlayer->ready = true;
-    allPlayers.push_back(std::move(publicPlayer));
-    for (auto& [territoryName, territoryData] : mapJson.items()) {
-        if (!territoryData["initPlayer"].is_null()) {
-            std::string playerName = territoryData["initPlayer"];
-            if (playerMap.find(playerName) == playerMap.end()) {
-                auto player = std::make_unique<Player>();
-                player->name = playerName;
-                player->centerCount = 0;
-                player->unitCount = 0;
-                player->vote = false;
-                player->ready = false;
-                playerMap[playerName] = player.get();
-                allPlayers.push_back(std::move(player));
+    out << json{{"traceEvents", events}, {"displayTimeUnit", "ms"}}.dump() << std::endl;
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+void SupportTable::build(const std::vector<Part*>& parts, size_t territories) {
+    words = territories <= denseLimit ? (territories + 63) / 64 : 0;
+    bits.assign(parts.size() * words, 0);
+    offsets.assign(parts.size() + 1, 0);
+    lists.clear();
+    for (const Part* part : parts) {
+        if (words) {
+            for (const Part* neighbor : part->neighbors) {
+                uint t = neighbor->belonged->id;
+                bits[part->id * words + t / 64] |= uint64_t(1) << (t % 64);
             }
+        } else {
+            size_t start = lists.size();
+            for (const Part* neighbor : part->neighbors) lists.push_back(neighbor->belonged->id);
+            std::sort(lists.begin() + start, lists.end());
+            lists.erase(std::unique(lists.begin() + start, lists.end()), lists.end());
         }
+        offsets[part->id + 1] = lists.size();
     }
 }
 
-void Game::initialize() {
-    json mapJson = json::parse(mapRaw);
-    
-    for (auto& territory : allTerritories) {
-        auto& territoryData = mapJson[territory->name];
-        if (!territoryData["initPlayer"].is_null()) {
-            std::string playerName = territoryData["initPlayer"];
-            std::string initPartName = territoryData["initPart"];
-            
-            auto playerIt = std::find_if(allPlayers.begin(), allPlayers.end(),
-                [&playerName](const auto& p) { return p->name == playerName; });
-            
-            if (playerIt != allPlayers.end()) {
-                Player* player = playerIt->get();
-                
-                auto partIt = std::find_if(territory->parts.begin(), territory->parts.end(),
-                    [&initPartName](const auto& p) { return p->name == initPartName; });
+bool SupportTable::canSupport(const Part* supporter, const Territory* target) const {
+    if (words) return bits[supporter->id * words + target->id / 64] >> (target->id % 64) & 1;
+    auto first = lists.begin() + offsets[supporter->id], last = lists.begin() + offsets[supporter->id + 1];
+    return std::binary_search(first, last, target->id);
+}
+
+size_t SupportTable::bytes() const {
+    return bits.capacity() * sizeof(uint64_t) + (offsets.capacity() + lists.capacity()) * sizeof(uint);
+}
+
+int InfluenceMap::threat(const Part* part, uint player) const {
+    for (const Entry& e : entries[part->id]) {
+        if (e.player == player) return e.threat;
+    }
+    return 0;
+}
+
+int InfluenceMap::support(const Part* part, uint player) const {
+    for (const Entry& e : entries[part->id]) {
+        if (e.player == player) return e.support;
+    }
+    return 0;
+}
+
+size_t InfluenceMap::bytes() const {
+    size_t total = entries.capacity() * sizeof(entries[0]);
+    for (const auto& list : entries) total += list.heapCapacity() * sizeof(Entry);
+    return total;
+}
+
+InfluenceMap::Entry& InfluenceMap::entry(const Part* part, uint player) {
+    for (Entry& e : entries[part->id]) {
+        if (e.player == player) return e;
+    }
+    entries[part->id].push_back({player, 0, 0});
+    return entries[part->id].back();
+}
+
+void InfluenceMap::prune(const Part* part) {
+    auto& list = entries[part->id];
+    for (Entry* e = list.begin(); e != list.end();) {
+        e = e->threat || e->support ? e + 1 : list.erase(e);
+    }
+}
+
+// The unit threatens each neighbor part and supports into every part of each territory it
+// reaches, counting a territory once even when several of its parts are neighbors.
+void InfluenceMap::update(const Part* unit, uint player, int delta) {
+    for (size_t i = 0; i < unit->neighbors.size(); i++) {
+        const Part* target = unit->neighbors[i];
+        entry(target, player).threat += delta;
+        const Territory* territory = target->belonged;
+        bool seen = false;
+        for (size_t j = 0; j < i && !seen; j++) seen = unit->neighbors[j]->belonged == territory;
+        if (!seen) {
+            for (const auto& part : territory->parts) entry(part.get(), player).support += delta;
+        }
+        if (delta < 0) {
+            for (const auto& part : territory->parts) prune(part.get());
+        }
+    }
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this]() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Helpers can be dequeued after every index is taken and the caller has returned, so the
+// shared counters live on the heap with the tasks rather than on the caller's stack.
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    auto run = [state, count, &body]() {
+        for (size_t i; (i = state->next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) state->error = std::current_exception();
+            }
+            if (state->done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+    size_t helpers = std::min(count, workers.size() + 1) - 1;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < helpers; i++) tasks.push_back(run);
+    }
+    wake.notify_all();
+    run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done.load(std::memory_order_acquire) == count; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : tick(tick), start(std::chrono::steady_clock::now()), current(0) {
+    for (auto& level : slots) {
+        for (auto& head : level) {
+            head.prev = head.next = &head;
+        }
+    }
+}
+
+void TimerWheel::place(Timer& timer) {
+    uint64_t delta = timer.expires > current ? timer.expires - current : 0;
+    int level = 0;
+    while (level < levelCount - 1 && delta >= (slotCount << (level * slotBits))) {
+        level++;
+    }
+    // Past the top level's range a timer waits in the farthest slot and is placed again
+    // when that slot cascades, keeping its real expiry.
+    uint64_t at = std::min(timer.expires, current + (slotCount << (level * slotBits)) - 1);
+    Timer& head = slots[level][(at >> (level * slotBits)) & (slotCount - 1)];
+    timer.prev = head.prev;
+    timer.next = &head;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+void TimerWheel::schedule(Timer& timer, std::chrono::milliseconds delay) {
+    cancel(timer);
+    timer.expires = current + std::max<uint64_t>(1, (delay.count() + tick.count() - 1) / tick.count());
+    place(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (!timer.pending()) return;
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = timer.next = nullptr;
+}
+
+void TimerWheel::cascade(int level) {
+    Timer& head = slots[level][(current >> (level * slotBits)) & (slotCount - 1)];
+    Timer* timer = head.next;
+    head.prev = head.next = &head;
+    while (timer != &head) {
+        Timer* next = timer->next;
+        place(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::advance(std::chrono::steady_clock::time_point now) {
+    uint64_t target = std::chrono::duration_cast<std::chrono::milliseconds>(now - start) / tick;
+    while (current < target) {
+        current++;
+        for (int level = 1; level < levelCount && (current & ((uint64_t(1) << (level * slotBits)) - 1)) == 0; level++) {
+            cascade(level);
+        }
+        // Detach the due slot first so callbacks may schedule or cancel freely.
+        Timer& head = slots[0][current & (slotCount - 1)];
+        if (head.next == &head) continue;
+        Timer due;
+        due.next = head.next;
+        due.prev = head.prev;
+        due.next->prev = &due;
+        due.prev->next = &due;
+        head.prev = head.next = &head;
+        while (due.next != &due) {
+            Timer* timer = due.next;
+            cancel(*timer);
+            timer->callback();
+        }
+    }
+}
+
+// Length of the well-formed UTF-8 sequence text starts with, 0 if it starts with a malformed one:
+// overlong forms, surrogates and code points past U+10FFFF are malformed.
+static size_t utf8Length(std::string_view text) {
+    auto within = [&text](size_t i, unsigned char low, unsigned char high) {
+        return i < text.size() && (unsigned char)text[i] >= low && (unsigned char)text[i] <= high;
+    };
+    unsigned char lead = text[0];
+    if (lead < 0x80) return 1;
+    if (lead >= 0xC2 && lead <= 0xDF) return within(1, 0x80, 0xBF) ? 2 : 0;
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        bool second = within(1, lead == 0xE0 ? 0xA0 : 0x80, lead == 0xED ? 0x9F : 0xBF);
+        return second && within(2, 0x80, 0xBF) ? 3 : 0;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        bool second = within(1, lead == 0xF0 ? 0x90 : 0x80, lead == 0xF4 ? 0x8F : 0xBF);
+        return second && within(2, 0x80, 0xBF) && within(3, 0x80, 0xBF) ? 4 : 0;
+    }
+    return 0;
+}
+
+// The text with each byte that starts no well-formed UTF-8 sequence replaced by U+FFFD.
+static std::string replaceMalformedUtf8(std::string_view text) {
+    std::string replaced;
+    replaced.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        size_t length = utf8Length(text.substr(i));
+        replaced.append(length ? text.substr(i, length) : std::string_view("\xEF\xBF\xBD"));
+        i += length ? length : 1;
+    }
+    return replaced;
+}
+
+PressStore::PressStore(std::pmr::memory_resource* resource)
+    : resource(resource), segments(resource), channels(resource), publicChannel(resource),
+      inboxes(resource), inboxCursor(resource), publicCursor(resource) {}
+
+PressRef PressStore::make(uint sender, uint recipient, uint phase, std::string_view text) {
+    return std::allocate_shared<PressMessage>(std::pmr::polymorphic_allocator<PressMessage>(resource),
+        PressMessage{sender, recipient, phase, std::pmr::string(text, resource)});
+}
+
+void PressStore::track(uint recipient) {
+    if (recipient >= inboxes.size()) {
+        inboxes.resize(recipient + 1);
+        inboxCursor.resize(recipient + 1, 0);
+        publicCursor.resize(recipient + 1, 0);
+    }
+}
+
+uint64_t PressStore::append(uint sender, uint recipient, uint phase, std::string_view text) {
+    if (count % segmentSize == 0) {
+        segments.push_back(std::make_unique<Segment>(resource));
+        segments.back()->messages.reserve(segmentSize);
+    }
+    uint64_t seq = count++;
+    // Stored as valid UTF-8, so spilling the message as JSON cannot fail.
+    PressRef message = make(sender, recipient, phase, replaceMalformedUtf8(text));
+    for (PressSubscriber* subscriber : subscribers) {
+        if (recipient == 0 || subscriber->recipient == recipient) {
+            subscriber->queue.push_back(message);
+        }
+    }
+    segments.back()->messages.push_back(std::move(message));
+    channels[uint64_t(sender) << 32 | recipient].push_back(seq);
+    track(std::max(sender, recipient));
+    if (recipient == 0) {
+        publicChannel.push_back(seq);
+    } else {
+        inboxes[recipient].push_back(seq);
+    }
+    return seq;
+}
+
+const PressMessage& PressStore::at(uint64_t seq) {
+    Segment& segment = *segments[seq / segmentSize];
+    if (segment.spilled) {
+        std::ifstream file(spillPath);
+        file.seekg(segment.offset);
+        std::string line;
+        segment.messages.clear();
+        for (size_t i = 0; i < segmentSize && std::getline(file, line); i++) {
+            json entry = json::parse(line);
+            segment.messages.push_back(make(entry["sender"], entry["recipient"], entry["phase"],
+                entry["text"].get<std::string>()));
+        }
+        segment.spilled = false;
+    }
+    return *segment.messages[seq % segmentSize];
+}
+
+const std::pmr::vector<uint64_t>& PressStore::channel(uint sender, uint recipient) const {
+    static const std::pmr::vector<uint64_t> empty;
+    auto channelIt = channels.find(uint64_t(sender) << 32 | recipient);
+    return channelIt != channels.end() ? channelIt->second : empty;
+}
+
+std::vector<uint64_t> PressStore::unread(uint recipient) {
+    track(recipient);
+    const std::pmr::vector<uint64_t>& inbox = inboxes[recipient];
+    size_t& inboxAt = inboxCursor[recipient];
+    size_t& publicAt = publicCursor[recipient];
+    std::vector<uint64_t> result;
+    result.reserve(inbox.size() - inboxAt + publicChannel.size() - publicAt);
+    std::merge(inbox.begin() + inboxAt, inbox.end(), publicChannel.begin() + publicAt, publicChannel.end(),
+        std::back_inserter(result));
+    inboxAt = inbox.size();
+    publicAt = publicChannel.size();
+    return result;
+}
+
+// Recipient 0 is public, read by spectators who may never come, so it never holds the floor.
+uint64_t PressStore::readFloor() const {
+    uint64_t floor = count;
+    for (size_t recipient = 1; recipient < inboxes.size(); recipient++) {
+        if (inboxCursor[recipient] < inboxes[recipient].size()) {
+            floor = std::min(floor, inboxes[recipient][inboxCursor[recipient]]);
+        }
+        if (publicCursor[recipient] < publicChannel.size()) {
+            floor = std::min(floor, publicChannel[publicCursor[recipient]]);
+        }
+    }
+    return floor;
+}
+
+// Only whole segments below before are released; the tail segment always stays in memory.
+void PressStore::spill(uint64_t before, const std::string& path) {
+    spillPath = path;
+    for (size_t index = 0; (index + 1) * segmentSize <= std::min(before, count) && index + 1 < segments.size(); index++) {
+        Segment& segment = *segments[index];
+        if (segment.spilled) continue;
+        if (segment.offset < 0) {
+            std::ofstream file(spillPath, std::ios::app);
+            file.seekp(0, std::ios::end);
+            segment.offset = file.tellp();
+            for (const PressRef& message : segment.messages) {
+                file << json{{"sender", message->sender}, {"recipient", message->recipient},
+                    {"phase", message->phase}, {"text", std::string(message->text)}}.dump() << '\n';
+            }
+        }
+        segment.messages.clear();
+        segment.messages.shrink_to_fit();
+        segment.spilled = true;
+    }
+}
+
+void PressStore::subscribe(PressSubscriber& subscriber) {
+    subscribers.push_back(&subscriber);
+}
+
+void PressStore::unsubscribe(PressSubscriber& subscriber) {
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), &subscriber), subscribers.end());
+}
+
+PressIndex::PressIndex(std::pmr::memory_resource* resource)
+    : words(resource), territoryNames(resource), playerNames(resource), territories(resource),
+      players(resource), pairs(resource), phaseStarts(resource) {}
+
+void PressIndex::addTerritoryName(const std::string& name, uint territory) {
+    territoryNames[std::pmr::string(name.data(), name.size())] = territory;
+    if (territory >= territories.size()) territories.resize(territory + 1);
+}
+
+void PressIndex::addPlayerName(const std::string& name, uint player) {
+    playerNames[std::pmr::string(name.data(), name.size())] = player;
+    if (player >= players.size()) players.resize(player + 1);
+}
+
+void PressIndex::add(uint64_t seq, const PressMessage& message) {
+    auto note = [seq](std::pmr::vector<uint64_t>& postings) {
+        if (postings.empty() || postings.back() != seq) postings.push_back(seq);
+    };
+    if (phaseStarts.empty() || phaseStarts.back().first != message.phase) {
+        phaseStarts.emplace_back(message.phase, seq);
+    }
+    uint low = std::min(message.sender, message.recipient);
+    uint high = std::max(message.sender, message.recipient);
+    pairs[uint64_t(low) << 32 | high].push_back(seq);
+    const std::pmr::string& text = message.text;
+    for (size_t begin = 0; begin < text.size();) {
+        auto isWord = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+        while (begin < text.size() && !isWord(text[begin])) begin++;
+        size_t end = begin;
+        while (end < text.size() && isWord(text[end])) end++;
+        if (end == begin) break;
+        std::pmr::string token(text, begin, end - begin, words.get_allocator());
+        auto territoryIt = territoryNames.find(token);
+        if (territoryIt != territoryNames.end()) note(territories[territoryIt->second]);
+        auto playerIt = playerNames.find(token);
+        if (playerIt != playerNames.end()) note(players[playerIt->second]);
+        std::transform(token.begin(), token.end(), token.begin(),
+            [](unsigned char c) { return std::tolower(c); });
+        note(words[token]);
+        begin = end;
+    }
+    count = seq + 1;
+}
+
+std::vector<uint64_t> PressIndex::query(const PressQuery& query) const {
+    static const std::pmr::vector<uint64_t> empty;
+    std::vector<const std::pmr::vector<uint64_t>*> lists;
+    for (const std::string& word : query.words) {
+        auto wordIt = words.find(std::pmr::string(word.data(), word.size()));
+        lists.push_back(wordIt != words.end() ? &wordIt->second : &empty);
+    }
+    if (query.territory >= 0) {
+        lists.push_back(size_t(query.territory) < territories.size() ? &territories[query.territory] : &empty);
+    }
+    if (query.mentioned >= 0) {
+        lists.push_back(size_t(query.mentioned) < players.size() ? &players[query.mentioned] : &empty);
+    }
+    if (query.between[0] >= 0 && query.between[1] >= 0) {
+        uint low = std::min(query.between[0], query.between[1]);
+        uint high = std::max(query.between[0], query.between[1]);
+        auto pairIt = pairs.find(uint64_t(low) << 32 | high);
+        lists.push_back(pairIt != pairs.end() ? &pairIt->second : &empty);
+    }
+
+    auto phaseAt = [this](uint phase) {
+        auto phaseIt = std::lower_bound(phaseStarts.begin(), phaseStarts.end(), phase,
+            [](const auto& start, uint value) { return start.first < value; });
+        return phaseIt != phaseStarts.end() ? phaseIt->second : count;
+    };
+    uint64_t first = phaseAt(query.fromPhase);
+    uint64_t last = query.toPhase == UINT_MAX ? count : phaseAt(query.toPhase + 1);
+
+    // Walk the shortest list and probe the rest with binary search.
+    std::vector<uint64_t> result;
+    if (lists.empty()) {
+        for (uint64_t seq = first; seq < last; seq++) result.push_back(seq);
+        return result;
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+    auto seqIt = std::lower_bound(lists[0]->begin(), lists[0]->end(), first);
+    for (; seqIt != lists[0]->end() && *seqIt < last; ++seqIt) {
+        bool matched = std::all_of(lists.begin() + 1, lists.end(),
+            [seq = *seqIt](const auto* list) { return std::binary_search(list->begin(), list->end(), seq); });
+        if (matched) result.push_back(*seqIt);
+    }
+    return result;
+}
+
+Game::Game(const std::string& mapPath, const std::string& rulesPath, const std::string& logPath) {
+    std::ifstream mapFile(mapPath);
+    std::ifstream rulesFile(rulesPath);
+    
+    if (!mapFile || !rulesFile) {
+        throw std::runtime_error("Failed to open input files");
+    }
+    
+    json mapJson = json::parse(mapFile);
+    json rulesJson = json::parse(rulesFile);
+    
+    mapRaw = std::make_shared<const std::string>(mapJson.dump());
+    rulesRaw = rulesJson.dump();
+    
+    winCondition = rulesJson["winCondition"];
+    buildRule = (rulesJson["buildRule"] == "allCenters") ? 1 : 0;
+    buildTime = rulesJson["buildTime"];
+    voteShown = rulesJson["voteShown"] == 1;
+    drawType = (rulesJson["drawType"] == "DSS") ? 0 : 1;
+    phaseCount = 1;
+    phaseType = 0;
+    phaseDeadline[0] = rulesJson.value("moveDeadline", 0u);
+    phaseDeadline[1] = rulesJson.value("retreatDeadline", 0u);
+    phaseDeadline[2] = rulesJson.value("buildDeadline", 0u);
+    phaseEnds = std::chrono::steady_clock::time_point::max();
+    wheel = nullptr;
+    notReady = 0;
+    pool = nullptr;
+    parallelThreshold = 256;
+    partitioned = true;
+    deadline.callback = [this]() { adjudicate(); };
+    logFilePath = logPath;
+    loggedPhases = 0;
+    
+    for (auto& [territoryName, territoryData] : mapJson.items()) {
+        auto territory = std::make_unique<Territory>();
+        territory->name = territoryName;
+        territory->id = allTerritories.size();
+        territory->center = territoryData["center"];
+        territory->owner = nullptr;
+        
+        for (auto& [partName, neighbors] : territoryData.items()) {
+            if (partName != "center" && partName != "initPlayer" && partName != "initPart") {
+                auto part = std::make_unique<Part>();
+                part->name = partName;
+                part->belonged = territory.get();
+                part->unit = nullptr;
+                part->LC = (partName.back() == 'C') ? 1 : 0;
+                part->id = allParts.size();
+                pressIndex.addTerritoryName(partName, allTerritories.size());
+                allParts.push_back(part.get());
+                partByName[part->name] = part.get();
+                territory->parts.push_back(std::move(part));
+            }
+        }
+        
+        pressIndex.addTerritoryName(territoryName, allTerritories.size());
+        territoryByName[territory->name] = territory.get();
+        allTerritories.push_back(std::move(territory));
+    }
+    linkNeighbors(mapJson);
+    influence.reset(allParts.size());
+    supports.build(allParts, allTerritories.size());
+    
+    auto publicPlayer = std::make_unique<Player>(&ordersMemory);
+    publicPlayer->name = "public";
+    publicPlayer->id = 0;
+    publicPlayer->centerCount = 0;
+    publicPlayer->unitCount = 0;
+    publicPlayer->vote = true;
+    publicPlayer->ready = true;
+    playerByName[publicPlayer->name] = publicPlayer.get();
+    allPlayers.push_back(std::move(publicPlayer));
+    for (auto& [territoryName, territoryData] : mapJson.items()) {
+        if (!territoryData["initPlayer"].is_null()) {
+            std::string playerName = territoryData["initPlayer"];
+            if (!findPlayer(playerName)) {
+                auto player = std::make_unique<Player>(&ordersMemory);
+                player->name = playerName;
+                player->id = allPlayers.size();
+                player->centerCount = 0;
+                player->unitCount = 0;
+                player->vote = false;
+                player->ready = false;
+                playerByName[player->name] = player.get();
+                pressIndex.addPlayerName(playerName, player->id);
+                press.track(player->id);
+                allPlayers.push_back(std::move(player));
+            }
+        }
+    }
+    // The log starts empty for every game, so a rerun never appends to an earlier game's log.
+    if (!(std::ofstream(logFilePath, std::ios::trunc) << "{\n}")) {
+        throw std::runtime_error("Cannot create log file " + logFilePath);
+    }
+    // Each game spills read press to its own fresh file, removed with the game; it is created
+    // last so a constructor that throws leaves no file behind.
+    const char* temporary = std::getenv("TMPDIR");
+    std::string pressPattern = std::string(temporary && *temporary ? temporary : "/tmp") + "/pisPressXXXXXX";
+    int pressFile = ::mkstemp(pressPattern.data());
+    if (pressFile < 0) throw std::runtime_error("Cannot create press spill file in " + pressPattern);
+    ::close(pressFile);
+    pressFilePath = pressPattern;
+}
+
+// The deadline timer is linked into a wheel the game does not own, and the press spill
+// file belongs to this game alone.
+Game::~Game() {
+    if (wheel) wheel->cancel(deadline);
+    std::remove(pressFilePath.c_str());
+}
+
+void Game::initialize() {
+    json mapJson = json::parse(*mapRaw);
+    
+    for (auto& territory : allTerritories) {
+        auto& territoryData = mapJson[territory->name];
+        if (!territoryData["initPlayer"].is_null()) {
+            std::string playerName = territoryData["initPlayer"];
+            std::string initPartName = territoryData["initPart"];
+            
+            Player* player = findPlayer(playerName);
+            
+            if (player) {
+                Part* part = findPart(initPartName);
                 
-                if (partIt != territory->parts.end()) {
-                    Part* part = partIt->get();
-                    part->unit = player;
-                    player->units.push_back(part);
+                if (part && part->belonged == territory.get()) {
+                    placeUnit(part, player);
+                    player->unitCount++;
+                }
+                
+                if (territory->center) {
+                    territory->owner = player;
+                    player->centerCount++;
+                    player->allowBuild.push_back(territory.get());
+                }
+            }
+        }
+    }
+    resetReady();
+    publishSnapshot();
+}
+
+// Renders the phase and map output once per phase and swaps it in; readers holding the
+// previous snapshot keep it alive until they drop it. The map file itself is shared, not copied.
+void Game::publishSnapshot() {
+    ScopedLatency timer(latency[mapLatency]);
+    ScopedTrace trace("publishSnapshot");
+    static const char* phaseNames[] = {"move", "retreat", "build"};
+    auto next = std::make_shared<StateSnapshot>();
+    next->phaseCount = phaseCount;
+    next->phaseType = phaseType;
+    std::string header = "Phase " + std::to_string(phaseCount) + " " + phaseNames[phaseType];
+    next->phase = header + "\n";
+    for (size_t i = 1; i < allPlayers.size(); i++) {
+        Player* player = allPlayers[i].get();
+        int difference = player->centerCount - int(player->units.size());
+        if (phaseType == 2 && difference != 0) {
+            next->phase += player->name + (difference > 0 ? " build " : " disband ") + std::to_string(std::abs(difference)) + "\n";
+        }
+    }
+    for (const auto& [part, player] : dislodgedUnits) {
+        next->phase += player->name + " retreat " + part->name + "\n";
+    }
+
+    json owners = json::object();
+    json units = json::object();
+    for (const auto& territory : allTerritories) {
+        if (territory->owner) owners[territory->name] = territory->owner->name;
+    }
+    for (size_t i = 1; i < allPlayers.size(); i++) {
+        json parts = json::array();
+        for (Part* part : allPlayers[i]->units) parts.push_back(part->name);
+        units[allPlayers[i]->name] = parts;
+    }
+    next->result = verdict;
+    next->mapText = mapRaw;
+    next->board = ",\"phase\":" + json(header).dump() + ",\"owners\":" + owners.dump() + ",\"units\":" + units.dump() + "}";
+    std::atomic_store_explicit(&published, std::shared_ptr<const StateSnapshot>(std::move(next)), std::memory_order_release);
+}
+
+Player* Game::findPlayer(std::string_view playerName) const {
+    auto playerIt = playerByName.find(playerName);
+    return playerIt != playerByName.end() ? playerIt->second : nullptr;
+}
+
+Territory* Game::findTerritory(std::string_view territoryName) const {
+    auto territoryIt = territoryByName.find(territoryName);
+    return territoryIt != territoryByName.end() ? territoryIt->second : nullptr;
+}
+
+// Neighbors name a part directly (split coasts) or a territory, meaning its part of the same
+// kind; for a coast part that is the coast listing this territory back, else its first coast.
+void Game::linkNeighbors(const json& mapJson) {
+    std::vector<const json*> lists(allParts.size());
+    size_t t = 0;
+    for (auto& [territoryName, territoryData] : mapJson.items()) {
+        for (auto& part : allTerritories[t++]->parts) {
+            lists[part->id] = &territoryData[part->name];
+        }
+    }
+    for (Part* part : allParts) {
+        const std::string& territoryName = part->belonged->name;
+        for (const auto& neighbor : *lists[part->id]) {
+            const std::string& neighborName = neighbor.get_ref<const std::string&>();
+            Part* target = findPart(neighborName);
+            Territory* other = target ? nullptr : findTerritory(neighborName);
+            if (other) {
+                for (auto& candidate : other->parts) {
+                    if (candidate->LC != part->LC) continue;
+                    if (!target) target = candidate.get();
+                    const json& back = *lists[candidate->id];
+                    if (std::find(back.begin(), back.end(), territoryName) != back.end()
+                        || std::find(back.begin(), back.end(), part->name) != back.end()) {
+                        target = candidate.get();
+                        break;
+                    }
+                }
+            }
+            if (target) part->neighbors.push_back(target);
+        }
+    }
+}
+
+Part* Game::findPart(std::string_view partName) const {
+    auto partIt = partByName.find(partName);
+    return partIt != partByName.end() ? partIt->second : nullptr;
+}
+
+// Players with nothing to submit this phase stay ready: in a move phase those without units,
+// in a retreat phase those without a dislodged unit, in a build phase those with nothing to
+// build or disband.
+void Game::resetReady() {
+    int count = 0;
+    for (size_t i = 1; i < allPlayers.size(); i++) {
+        Player* player = allPlayers[i].get();
+        bool idle;
+        if (phaseType == 1) {
+            idle = std::none_of(dislodgedUnits.begin(), dislodgedUnits.end(),
+                [player](const std::pair<Part*, Player*>& dislodged) { return dislodged.second == player; });
+        } else if (phaseType == 2) {
+            idle = player->centerCount == int(player->units.size());
+        } else {
+            idle = player->units.empty();
+        }
+        player->ready.store(idle, std::memory_order_relaxed);
+        count += idle ? 0 : 1;
+    }
+    notReady.store(count, std::memory_order_release);
+}
+
+// The player whose change takes the count to zero runs the phase, so nothing polls allPlayers.
+// Like every other mutator it runs on the thread that owns the game; only allReady() may be
+// read from other threads.
+void Game::setReady(Player* player, bool ready) {
+    if (player->ready.exchange(ready, std::memory_order_acq_rel) == ready) return;
+    if (!ready) {
+        notReady.fetch_add(1, std::memory_order_acq_rel);
+    } else if (notReady.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        adjudicate();
+    }
+}
+
+void Game::setVote(Player* player, bool vote) {
+    player->vote = vote;
+}
+
+// Validates the ordered unit (or build site) and replaces any earlier order for it this phase.
+// Valid orders are stored without touching the global heap; order strings live in the
+// game's orders pool.
+void Game::submitOrder(Player* player, const std::string& order) {
+    AllocScope counter(allocations[orderAllocations]);
+    std::string_view words(order);
+    std::string_view partName = words.substr(0, words.find(' '));
+    std::string_view type = words.size() > partName.size() ? words.substr(partName.size() + 1) : std::string_view();
+    type = type.substr(0, type.find(' '));
+    Part* part = findPart(partName);
+    if (!part) {
+        throw std::runtime_error("Unknown part " + std::string(partName));
+    }
+    if (type == "B") {
+        bool allowed = std::find(player->allowBuild.begin(), player->allowBuild.end(), part->belonged) != player->allowBuild.end();
+        if (phaseType != 2 || !allowed || part->belonged->owner != player || part->unit) {
+            throw std::runtime_error("Cannot build in " + std::string(partName));
+        }
+    } else if (phaseType == 1) {
+        bool dislodged = std::find(dislodgedUnits.begin(), dislodgedUnits.end(), std::make_pair(part, player)) != dislodgedUnits.end();
+        if (!dislodged || (type != "R" && type != "D")) {
+            throw std::runtime_error(player->name + " has no unit to retreat in " + std::string(partName));
+        }
+    } else if (part->unit != player) {
+        throw std::runtime_error(player->name + " has no unit in " + std::string(partName));
+    } else if (type == "S") {
+        std::string_view targetName = words.substr(std::min(words.size(), partName.size() + type.size() + 2));
+        targetName = targetName.substr(0, targetName.find(' '));
+        Part* target = findPart(targetName);
+        if (!target) {
+            throw std::runtime_error("Unknown part " + std::string(targetName));
+        }
+        if (!supports.canSupport(part, target->belonged)) {
+            throw std::runtime_error(std::string(partName) + " cannot support into " + target->belonged->name);
+        }
+    }
+    for (auto& existing : player->orders) {
+        if (existing.size() > partName.size() && existing.compare(0, partName.size(), partName) == 0
+            && existing[partName.size()] == ' ') {
+            existing = order;
+            return;
+        }
+    }
+    player->orders.emplace_back(order);
+}
+
+uint64_t Game::sendPress(Player* sender, Player* recipient, std::string_view message) {
+    if (sender == allPlayers[0].get()) {
+        throw std::runtime_error("public cannot send press");
+    }
+    uint64_t seq = press.append(sender->id, recipient->id, phaseCount, message);
+    pressIndex.add(seq, press.at(seq));
+    return seq;
+}
+
+// Appends this phase's orders to the game's log file, rewriting only its closing brace.
+void Game::writeLog() {
+    ScopedLatency timer(latency[logLatency]);
+    ScopedTrace trace("logFlush");
+    static const char* phaseNames[] = {"move", "retreat", "build"};
+    json orders = json::object();
+    for (size_t i = 1; i < allPlayers.size(); i++) {
+        json playerOrders = json::array();
+        for (const auto& order : allPlayers[i]->orders) playerOrders.push_back(std::string(order));
+        orders[allPlayers[i]->name] = playerOrders;
+    }
+    log.clear();
+    log += json("Phase " + std::to_string(phaseCount) + " " + phaseNames[phaseType]).dump();
+    log += ": ";
+    log += orders.dump();
+
+    std::fstream file(logFilePath, std::ios::in | std::ios::out);
+    if (!file) {
+        std::ofstream(logFilePath) << "{\n" << log << "\n}";
+        loggedPhases = 1;
+        return;
+    }
+    file.seekp(-2, std::ios::end);
+    file << (loggedPhases++ ? ",\n" : "\n") << log << "\n}";
+}
+
+json Game::latencyStats() const {
+    static const char* sections[] = {"move", "retreat", "build", "votes", "map", "log"};
+    json stats = json::object();
+    for (int i = 0; i < latencySections; i++) {
+        stats[sections[i]] = {{"count", latency[i].count()}, {"p50", latency[i].percentile(0.5)},
+            {"p90", latency[i].percentile(0.9)}, {"p99", latency[i].percentile(0.99)}, {"max", latency[i].max()}};
+    }
+    return stats;
+}
+
+json Game::allocationStats() const {
+    static const char* sections[] = {"adjudicate", "phase", "order", "legalOrders"};
+    json stats = json::object();
+    for (int i = 0; i < allocationSections; i++) {
+        stats[sections[i]] = {{"calls", allocations[i].calls.load()}, {"allocations", allocations[i].allocations.load()},
+            {"bytes", allocations[i].bytes.load()}, {"maxPerCall", allocations[i].maxPerCall.load()}};
+    }
+    return stats;
+}
+
+// Orders in log.json format the player could submit this phase. Convoys are generated for
+// single-fleet routes only; longer chains are accepted from players but not enumerated.
+std::vector<std::string> Game::legalOrders(const Player* player) const {
+    AllocScope counter(allocations[legalOrdersAllocations]);
+    std::vector<std::string> orders;
+    auto reaches = [](const Part* from, const Territory* territory) {
+        return std::any_of(from->neighbors.begin(), from->neighbors.end(),
+            [territory](const Part* n) { return n->belonged == territory; });
+    };
+    auto landOf = [](const Territory* territory) -> const Part* {
+        for (const auto& part : territory->parts) {
+            if (!part->LC) return part.get();
+        }
+        return nullptr;
+    };
+    if (phaseType == 2) {
+        int builds = player->centerCount - int(player->units.size());
+        for (Territory* home : player->allowBuild) {
+            if (builds <= 0 || home->owner != player) continue;
+            bool occupied = std::any_of(home->parts.begin(), home->parts.end(), [](const auto& p) { return p->unit; });
+            for (const auto& part : home->parts) {
+                if (!occupied) orders.push_back(part->name + " B");
+            }
+        }
+        if (builds < 0) {
+            for (Part* unit : player->units) orders.push_back(unit->name + " D");
+        }
+        return orders;
+    }
+    if (phaseType == 1) {
+        for (size_t i = 0; i < dislodgedUnits.size(); i++) {
+            const auto& [part, owner] = dislodgedUnits[i];
+            if (owner != player) continue;
+            orders.push_back(part->name + " D");
+            for (Part* target : part->neighbors) {
+                if (canRetreat(i, target)) orders.push_back(part->name + " R " + target->name);
+            }
+        }
+        return orders;
+    }
+    for (Part* unit : player->units) {
+        orders.push_back(unit->name + " H");
+        for (Part* target : unit->neighbors) {
+            orders.push_back(unit->name + " M " + target->name);
+        }
+        // Support any unit into, or holding in, a territory this unit could move to. Origins are
+        // found through every part of the target so armies and fleets support each other.
+        std::vector<const Territory*> targets;
+        for (Part* target : unit->neighbors) targets.push_back(target->belonged);
+        std::sort(targets.begin(), targets.end(), [](const Territory* a, const Territory* b) { return a->id < b->id; });
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+        for (const Territory* into : targets) {
+            std::vector<const Part*> origins;
+            for (const auto& held : into->parts) {
+                if (held->unit && held.get() != unit) orders.push_back(unit->name + " S " + held->name);
+                for (Part* around : held->neighbors) {
+                    for (const auto& origin : around->belonged->parts) {
+                        if (origin->unit && origin.get() != unit) origins.push_back(origin.get());
+                    }
+                }
+            }
+            std::sort(origins.begin(), origins.end(), [](const Part* a, const Part* b) { return a->id < b->id; });
+            origins.erase(std::unique(origins.begin(), origins.end()), origins.end());
+            for (const Part* origin : origins) {
+                for (Part* destination : origin->neighbors) {
+                    if (destination->belonged == into) {
+                        orders.push_back(unit->name + " S " + destination->name + " from " + origin->name);
+                    }
+                }
+            }
+        }
+        const Territory* here = unit->belonged;
+        bool atSea = unit->LC && !landOf(here);
+        if (atSea) {
+            for (Part* armySide : unit->neighbors) {
+                const Part* army = landOf(armySide->belonged);
+                if (!army || !army->unit) continue;
+                for (Part* landing : unit->neighbors) {
+                    const Part* destination = landOf(landing->belonged);
+                    if (destination && destination != army) {
+                        orders.push_back(unit->name + " C " + destination->name + " from " + army->name);
+                    }
+                }
+            }
+        } else if (!unit->LC) {
+            for (const auto& coast : here->parts) {
+                if (!coast->LC) continue;
+                for (Part* sea : coast->neighbors) {
+                    if (landOf(sea->belonged)) continue;
+                    for (Part* landing : sea->neighbors) {
+                        const Part* destination = landOf(landing->belonged);
+                        if (destination && destination->belonged != here && !reaches(unit, destination->belonged)) {
+                            orders.push_back(unit->name + " V " + destination->name);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::sort(orders.begin(), orders.end());
+    orders.erase(std::unique(orders.begin(), orders.end()), orders.end());
+    return orders;
+}
+
+// Per part: the power's unit, another power's unit, supply center, center owned by the power,
+// center owned by another power, coast part, and the power's and the strongest enemy's threat.
+std::vector<float> Game::encodeParts(const Player* power) const {
+    std::vector<float> encoded(allParts.size() * partFeatures, 0.0f);
+    for (const Part* part : allParts) {
+        float* row = encoded.data() + part->id * partFeatures;
+        const Territory* territory = part->belonged;
+        row[0] = part->unit == power;
+        row[1] = part->unit && part->unit != power;
+        row[2] = territory->center;
+        row[3] = territory->center && territory->owner == power;
+        row[4] = territory->center && territory->owner && territory->owner != power;
+        row[5] = part->LC;
+        for (const InfluenceMap::Entry& entry : influence.at(part)) {
+            if (entry.player == power->id) {
+                row[6] = entry.threat;
+            } else {
+                row[7] = std::max<float>(row[7], entry.threat);
+            }
+        }
+    }
+    return encoded;
+}
+
+PartGraph Game::partGraph() const {
+    PartGraph graph;
+    graph.offsets.reserve(allParts.size() + 1);
+    graph.offsets.push_back(0);
+    for (const Part* part : allParts) {
+        for (const Part* neighbor : part->neighbors) graph.neighbors.push_back(neighbor->id);
+        graph.offsets.push_back(graph.neighbors.size());
+    }
+    return graph;
+}
+
+// Order-independent hash of the board: units, owners, dislodged units and the phase.
+uint64_t Game::stateHash() const {
+    auto mix = [](uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    };
+    uint64_t hash = mix(uint64_t(phaseCount) << 8 | phaseType);
+    for (const Part* part : allParts) {
+        if (part->unit) hash ^= mix(uint64_t(1) << 62 | uint64_t(part->id) << 24 | part->unit->id);
+    }
+    for (const auto& territory : allTerritories) {
+        if (territory->owner) hash ^= mix(uint64_t(2) << 62 | uint64_t(territory->id) << 24 | territory->owner->id);
+    }
+    for (const auto& [part, player] : dislodgedUnits) {
+        hash ^= mix(uint64_t(3) << 62 | uint64_t(part->id) << 24 | player->id);
+    }
+    return hash;
+}
+
+// Press, log and orders are counted by their allocators; topology and board state are
+// allocated once at load or reuse their capacity, so they are sized by walking them.
+json Game::memoryStats() const {
+    size_t topology = mapRaw->capacity() + rulesRaw.capacity()
+        + allTerritories.capacity() * sizeof(allTerritories[0]);
+    for (const auto& territory : allTerritories) {
+        topology += sizeof(Territory) + territory->name.capacity()
+            + territory->parts.capacity() * sizeof(territory->parts[0]);
+        for (const auto& part : territory->parts) {
+            topology += sizeof(Part) + part->name.capacity() + part->neighbors.heapCapacity() * sizeof(Part*);
+        }
+    }
+    size_t state = allPlayers.capacity() * sizeof(allPlayers[0])
+        + dislodgedUnits.capacity() * sizeof(dislodgedUnits[0])
+        + (dislodgedFrom.capacity() + standoffs.capacity()) * sizeof(Territory*);
+    for (const auto& player : allPlayers) {
+        state += sizeof(Player) + player->name.capacity() + player->units.heapCapacity() * sizeof(Part*)
+            + player->allowBuild.heapCapacity() * sizeof(Territory*);
+    }
+    state += influence.bytes();
+    topology += supports.bytes();
+    return {{"topology", topology}, {"state", state}, {"press", pressMemory.bytes()},
+        {"log", logMemory.bytes()}, {"orders", ordersMemory.bytes()}, {"reserved", reserved.bytes()}};
+}
+
+// Runs every queued command on the owner thread, between adjudications.
+void Game::drain() {
+    std::string line;
+    while (commands.pop(line)) {
+        ScopedTrace trace("command");
+        try {
+            command(line);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+}
+
+// Handles one std input line, e.g. `diplomacy --ready ENG 1`.
+void Game::command(const std::string& line) {
+    std::istringstream input(line);
+    std::string program, flag;
+    input >> program >> flag;
+    if (flag == "--ready") {
+        std::string playerName;
+        int value = 0;
+        input >> playerName >> value;
+        Player* player = findPlayer(playerName);
+        if (!player || player == allPlayers[0].get()) {
+            throw std::runtime_error("Unknown player " + playerName);
+        }
+        setReady(player, value == 1);
+    } else if (flag == "--draw") {
+        std::string playerName;
+        int value = 0;
+        input >> playerName >> value;
+        Player* player = findPlayer(playerName);
+        if (!player || player == allPlayers[0].get()) {
+            throw std::runtime_error("Unknown player " + playerName);
+        }
+        setVote(player, value == 1);
+    } else if (flag == "--order") {
+        std::string playerName;
+        std::vector<std::string> words;
+        input >> playerName;
+        for (std::string word; input >> word;) {
+            if (word != "to") words.push_back(word);
+        }
+        Player* player = findPlayer(playerName);
+        if (!player || player == allPlayers[0].get()) {
+            throw std::runtime_error("Unknown player " + playerName);
+        }
+        // `H/B/D $partName` is logged as `$partName H/B/D`.
+        if (words.size() == 2 && (words[0] == "H" || words[0] == "B" || words[0] == "D")) {
+            std::swap(words[0], words[1]);
+        }
+        std::string order;
+        for (const std::string& word : words) {
+            order += (order.empty() ? "" : " ") + word;
+        }
+        submitOrder(player, order);
+    } else if (flag == "--latency") {
+        std::cout << latencyStats().dump() << std::endl;
+    } else if (flag == "--map" || flag == "--phase") {
+        ScopedLatency timer(latency[mapLatency]);
+        std::shared_ptr<const StateSnapshot> state = snapshot();
+        if (state && flag == "--map") {
+            state->writeMap(std::cout);
+            std::cout << "\n";
+        }
+        if (state && flag == "--phase") std::cout << state->phase;
+        std::cout << std::flush;
+    } else if (flag == "--stats") {
+        std::cout << memoryStats().dump() << std::endl;
+    } else if (flag == "--bot") {
+        std::string playerName;
+        input >> playerName;
+        Player* player = findPlayer(playerName);
+        if (!player || player == allPlayers[0].get()) {
+            throw std::runtime_error("Unknown player " + playerName);
+        }
+        int milliseconds = 0;
+        input >> milliseconds;
+        BeamSearchBot bot(*this);
+        SearchBudget budget = bot.phaseBudget();
+        if (milliseconds > 0) {
+            budget.deadline = std::min(budget.deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds));
+        }
+        SearchResult result = bot.search(player, BeamOptions(), budget);
+        for (const std::string& order : result.orders) {
+            submitOrder(player, order);
+            std::cout << playerName << " " << order << std::endl;
+        }
+        std::cout << json{{"nodes", result.nodes}, {"nodesPerSecond", result.nodesPerSecond},
+            {"complete", result.complete}}.dump() << std::endl;
+    } else if (flag == "--allocations") {
+        std::cout << allocationStats().dump() << std::endl;
+    } else if (flag == "--trace") {
+        std::string argument;
+        input >> argument;
+        if (argument == "1" || argument == "0") {
+            Tracer::enable(argument == "1");
+        } else {
+            std::ofstream file(argument);
+            if (!file) throw std::runtime_error("Cannot write " + argument);
+            Tracer::dump(file);
+        }
+    } else if (flag == "--press") {
+        std::string playerName, recipientName, message;
+        input >> playerName >> recipientName;
+        Player* player = findPlayer(playerName);
+        if (!player) {
+            throw std::runtime_error("Unknown player " + playerName);
+        }
+        uint sender = player->id;
+        if (recipientName.empty()) {
+            for (uint64_t seq : press.unread(sender)) {
+                const PressMessage& entry = press.at(seq);
+                std::cout << (entry.recipient == 0 ? "public" : allPlayers[entry.sender]->name)
+                          << ": " << entry.text << std::endl;
+            }
+            return;
+        }
+        Player* recipient = findPlayer(recipientName);
+        if (!recipient) {
+            throw std::runtime_error("Unknown player " + recipientName);
+        }
+        std::getline(input >> std::ws, message);
+        sendPress(player, recipient, message);
+    } else if (flag == "--search") {
+        PressQuery query;
+        std::string term;
+        auto playerId = [this](const std::string& playerName) {
+            Player* player = findPlayer(playerName);
+            if (!player) throw std::runtime_error("Unknown player " + playerName);
+            return int(player->id);
+        };
+        while (input >> term) {
+            size_t split = term.find('=');
+            std::string key = split == std::string::npos ? "" : term.substr(0, split);
+            std::string value = term.substr(split + 1);
+            if (key == "territory") {
+                Territory* territory = findTerritory(value);
+                if (!territory) throw std::runtime_error("Unknown territory " + value);
+                query.territory = territory->id;
+            } else if (key == "mentions") {
+                query.mentioned = playerId(value);
+            } else if (key == "between") {
+                size_t comma = value.find(',');
+                query.between[0] = playerId(value.substr(0, comma));
+                query.between[1] = playerId(comma == std::string::npos ? "" : value.substr(comma + 1));
+            } else if (key == "phases") {
+                size_t dash = value.find('-');
+                query.fromPhase = std::stoul(value.substr(0, dash));
+                query.toPhase = dash == std::string::npos ? query.fromPhase : std::stoul(value.substr(dash + 1));
+            } else {
+                std::transform(term.begin(), term.end(), term.begin(),
+                    [](unsigned char c) { return std::tolower(c); });
+                query.words.push_back(term);
+            }
+        }
+        for (uint64_t seq : pressIndex.query(query)) {
+            const PressMessage& entry = press.at(seq);
+            std::cout << "Phase " << entry.phase << " " << allPlayers[entry.sender]->name << " -> "
+                      << allPlayers[entry.recipient]->name << ": " << entry.text << std::endl;
+        }
+    }
+}
+
+void Game::attachTimer(TimerWheel& timerWheel) {
+    if (wheel) wheel->cancel(deadline);
+    wheel = &timerWheel;
+    phaseEnds = std::chrono::steady_clock::time_point::max();
+    if (phaseDeadline[phaseType]) {
+        wheel->schedule(deadline, std::chrono::seconds(phaseDeadline[phaseType]));
+        phaseEnds = std::chrono::steady_clock::now() + std::chrono::seconds(phaseDeadline[phaseType]);
+    }
+}
+
+void Game::attachPool(ThreadPool& threadPool, size_t threshold) {
+    pool = &threadPool;
+    parallelThreshold = threshold;
+}
+
+// Union-find over territories: every part an order names joins its territory to the ordered
+// unit's, so a move into an occupied territory, a support and the units it supports, or a
+// convoy and its army all end up in the same region. Unpartitioned, every territory joins
+// the first and the board is one region.
+void Game::orderRegions() {
+    std::vector<uint>& parent = regionParent;
+    parent.resize(allTerritories.size());
+    for (uint i = 0; i < parent.size(); i++) parent[i] = partitioned ? i : 0;
+    auto root = [&parent](uint i) {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    for (size_t p = 1; p < allPlayers.size() && partitioned; p++) {
+        for (const auto& order : allPlayers[p]->orders) {
+            std::string_view words(order);
+            size_t end = words.find(' ');
+            Part* unit = findPart(words.substr(0, end));
+            if (!unit) continue;
+            while (end != std::string_view::npos) {
+                words.remove_prefix(end + 1);
+                end = words.find(' ');
+                std::string_view word = words.substr(0, end);
+                Part* part = word.size() > 1 ? findPart(word) : nullptr;
+                if (part) parent[root(part->belonged->id)] = root(unit->belonged->id);
+            }
+        }
+    }
+
+    regionCount = 0;
+    regionOf.assign(allTerritories.size(), -1);
+    for (auto& territory : allTerritories) {
+        uint r = root(territory->id);
+        if (regionOf[r] < 0) {
+            regionOf[r] = regionCount;
+            if (regionCount == regions.size()) regions.emplace_back();
+            regions[regionCount].territories.clear();
+            regions[regionCount].orders.clear();
+            regionCount++;
+        }
+        regions[regionOf[r]].territories.push_back(territory.get());
+    }
+    for (size_t p = 1; p < allPlayers.size(); p++) {
+        for (const auto& order : allPlayers[p]->orders) {
+            Part* unit = findPart(std::string_view(order).substr(0, order.find(' ')));
+            if (unit) regions[regionOf[root(unit->belonged->id)]].orders.push_back(&order);
+        }
+    }
+}
+
+// Dislodged units leave the board first and every mover is lifted before any is placed,
+// so swaps through convoys and rotations apply cleanly.
+void Game::applyResolution(const Resolution& resolution) {
+    for (size_t i = 0; i < resolution.dislodged.size(); i++) {
+        dislodgedUnits.emplace_back(resolution.dislodged[i], liftUnit(resolution.dislodged[i]));
+        dislodgedFrom.push_back(resolution.attackedFrom[i]);
+    }
+    standoffs.insert(standoffs.end(), resolution.standoffs.begin(), resolution.standoffs.end());
+    movers.clear();
+    for (const auto& move : resolution.moves) {
+        movers.push_back(liftUnit(move.first));
+    }
+    for (size_t i = 0; i < resolution.moves.size(); i++) {
+        placeUnit(resolution.moves[i].second, movers[i]);
+    }
+}
+
+void Game::placeUnit(Part* part, Player* player) {
+    part->unit = player;
+    player->units.push_back(part);
+    influence.place(part, player->id);
+}
+
+Player* Game::liftUnit(Part* part) {
+    Player* player = part->unit;
+    player->units.erase(std::find(player->units.begin(), player->units.end(), part));
+    part->unit = nullptr;
+    influence.lift(part, player->id);
+    return player;
+}
+
+// Resolves one region by the DATC rules: a support is cut by an attack from anywhere but the
+// territory it supports into, or by dislodgement; a power never dislodges or helps dislodge
+// its own unit; head-to-head moves compare both moves' strengths; rings of moves all succeed;
+// a convoyed army moves only while some route of undislodged convoying fleets remains.
+// Units without a valid order hold. Convoy paradoxes that do not settle within a few rounds
+// are ended by failing the region's convoyed moves.
+void Game::resolveMoves(const Region& region, Resolution& resolution) const {
+    using Unit = Resolution::Unit;
+    auto& units = resolution.units;
+    auto& unitAt = resolution.unitAt;
+    auto& arrivals = resolution.arrivals;
+    auto& backing = resolution.backing;
+    auto& convoys = resolution.convoys;
+    auto& route = resolution.route;
+    resolution.moves.clear();
+    resolution.dislodged.clear();
+    resolution.attackedFrom.clear();
+    resolution.standoffs.clear();
+    units.clear();
+    unitAt.clear();
+    convoys.clear();
+
+    for (Territory* territory : region.territories) {
+        for (const auto& part : territory->parts) {
+            if (!part->unit) continue;
+            unitAt.emplace_back(territory->id, uint(units.size()));
+            units.push_back({part.get(), 'H', nullptr, nullptr, -1, false, false, false, false, 0, 0});
+        }
+    }
+    std::sort(unitAt.begin(), unitAt.end());
+    auto unitIn = [&unitAt](const Territory* territory) {
+        auto it = std::lower_bound(unitAt.begin(), unitAt.end(), std::make_pair(territory->id, 0u));
+        return it != unitAt.end() && it->first == territory->id ? int(it->second) : -1;
+    };
+    auto owner = [&units](size_t u) { return units[u].part->unit; };
+
+    for (const std::pmr::string* order : region.orders) {
+        std::string_view words[5];
+        size_t count = 0;
+        for (std::string_view rest(*order); count < 5 && !rest.empty(); count++) {
+            size_t end = rest.find(' ');
+            words[count] = rest.substr(0, end);
+            rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+        }
+        Part* part = count >= 2 ? findPart(words[0]) : nullptr;
+        int u = part ? unitIn(part->belonged) : -1;
+        if (u < 0 || units[u].part != part || words[1].size() != 1) continue;
+        Unit& unit = units[u];
+        Part* target = count >= 3 ? findPart(words[2]) : nullptr;
+        Part* origin = count == 5 && words[3] == "from" ? findPart(words[4]) : nullptr;
+        if (!target || target->belonged == part->belonged) continue;
+        bool adjacent = std::find(part->neighbors.begin(), part->neighbors.end(), target) != part->neighbors.end();
+        bool atSea = std::all_of(part->belonged->parts.begin(), part->belonged->parts.end(),
+            [](const auto& p) { return p->LC; });
+        char type = words[1][0];
+        if ((type == 'M' && count == 3 && adjacent) || (type == 'V' && count == 3 && !part->LC)
+            || (type == 'S' && (count == 3 || origin) && supports.canSupport(part, target->belonged))
+            || (type == 'C' && origin && part->LC && atSea)) {
+            unit.order = type;
+            unit.target = target;
+            unit.origin = origin;
+        }
+    }
+    for (size_t s = 0; s < units.size(); s++) {
+        Unit& unit = units[s];
+        if (unit.order != 'S' && unit.order != 'C') continue;
+        int o = unitIn((unit.origin ? unit.origin : unit.target)->belonged);
+        if (o < 0 || size_t(o) == s) continue;
+        const Unit& other = units[o];
+        bool moving = other.order == 'M' || other.order == 'V';
+        bool matches = unit.order == 'C' ? other.order == 'V' && other.target->belonged == unit.target->belonged
+            : unit.origin ? moving && other.target->belonged == unit.target->belonged : !moving;
+        if (!matches) continue;
+        unit.other = o;
+        if (unit.order == 'C') convoys.emplace_back(o, s);
+    }
+    std::sort(convoys.begin(), convoys.end());
+
+    auto touches = [](const Part* fleet, const Territory* territory) {
+        return std::any_of(fleet->neighbors.begin(), fleet->neighbors.end(),
+            [territory](const Part* n) { return n->belonged == territory; });
+    };
+    // Breadth-first over the army's undislodged convoying fleets, from its coast to the destination.
+    auto convoyRoute = [&](uint army) {
+        auto first = std::lower_bound(convoys.begin(), convoys.end(), std::make_pair(army, 0u));
+        auto last = std::lower_bound(first, convoys.end(), std::make_pair(army + 1, 0u));
+        route.clear();
+        for (auto it = first; it != last; it++) {
+            Unit& fleet = units[it->second];
+            fleet.mark = !fleet.dislodged && touches(fleet.part, units[army].part->belonged);
+            if (fleet.mark) route.push_back(it->second);
+        }
+        for (size_t i = 0; i < route.size(); i++) {
+            const Part* fleet = units[route[i]].part;
+            if (touches(fleet, units[army].target->belonged)) return true;
+            for (auto it = first; it != last; it++) {
+                Unit& next = units[it->second];
+                if (next.mark || next.dislodged) continue;
+                if (std::find(fleet->neighbors.begin(), fleet->neighbors.end(), next.part) != fleet->neighbors.end()) {
+                    next.mark = 1;
+                    route.push_back(it->second);
+                }
+            }
+        }
+        return false;
+    };
+    auto into = [&units](size_t m) { return units[m].target->belonged->id; };
+    auto movedInto = [&arrivals](uint territory) {
+        return std::make_pair(std::lower_bound(arrivals.begin(), arrivals.end(), std::make_pair(territory, 0u)),
+            std::lower_bound(arrivals.begin(), arrivals.end(), std::make_pair(territory + 1, 0u)));
+    };
+    auto strength = [&](size_t u) {
+        auto first = std::lower_bound(backing.begin(), backing.end(), std::make_pair(uint(u), 0u));
+        auto last = std::lower_bound(first, backing.end(), std::make_pair(uint(u) + 1, 0u));
+        return 1 + int(last - first);
+    };
+    // Supports from the defending power do not help dislodge it, and nothing dislodges its own side.
+    auto strengthAgainst = [&](size_t m, const Player* defender) {
+        if (owner(m) == defender) return 0;
+        auto first = std::lower_bound(backing.begin(), backing.end(), std::make_pair(uint(m), 0u));
+        auto last = std::lower_bound(first, backing.end(), std::make_pair(uint(m) + 1, 0u));
+        return 1 + int(std::count_if(first, last, [&](const auto& b) { return owner(b.second) != defender; }));
+    };
+    auto headToHead = [&units](size_t m, int d) {
+        return d >= 0 && units[m].order == 'M' && units[d].order == 'M'
+            && units[d].target->belonged == units[m].part->belonged;
+    };
+
+    const int roundLimit = 8;
+    bool paradox = false;
+    for (int round = 0;; round++) {
+        arrivals.clear();
+        for (size_t u = 0; u < units.size(); u++) {
+            Unit& unit = units[u];
+            unit.attacks = unit.order == 'M' || (unit.order == 'V' && !paradox && convoyRoute(u));
+            unit.status = 0;
+            if (unit.attacks) arrivals.emplace_back(into(u), u);
+        }
+        std::sort(arrivals.begin(), arrivals.end());
+        backing.clear();
+        for (size_t s = 0; s < units.size(); s++) {
+            Unit& unit = units[s];
+            if (unit.order != 'S' || unit.other < 0) continue;
+            unit.cut = unit.dislodged;
+            auto [first, last] = movedInto(unit.part->belonged->id);
+            for (auto it = first; it != last && !unit.cut; it++) {
+                unit.cut = owner(it->second) != owner(s) && units[it->second].part->belonged != unit.target->belonged;
+            }
+            if (!unit.cut) backing.emplace_back(unit.other, s);
+        }
+        std::sort(backing.begin(), backing.end());
+
+        for (bool progress = true; progress;) {
+            progress = false;
+            bool open = false;
+            for (size_t m = 0; m < units.size(); m++) {
+                Unit& unit = units[m];
+                if (!unit.attacks || unit.status) continue;
+                int d = unitIn(unit.target->belonged);
+                int full = strength(m);
+                int preventMax = 0, preventMin = 0;
+                auto [first, last] = movedInto(into(m));
+                for (auto it = first; it != last; it++) {
+                    if (it->second == m) continue;
+                    int high = strength(it->second), low = high;
+                    // A move beaten head-to-head prevents nothing.
+                    if (headToHead(it->second, d)) {
+                        if (units[d].status == 1) high = low = 0;
+                        if (units[d].status == 0) low = 0;
+                    }
+                    preventMax = std::max(preventMax, high);
+                    preventMin = std::max(preventMin, low);
+                }
+                unit.clearIfLeft = full > preventMax;
+                bool wins, loses;
+                if (d < 0 || (units[d].attacks && !headToHead(m, d) && units[d].status == 1)) {
+                    wins = full > preventMax;
+                    loses = full <= preventMin;
+                } else if (!units[d].attacks || headToHead(m, d)) {
+                    int attack = strengthAgainst(m, owner(d));
+                    int defence = strength(d);
+                    wins = attack > std::max(defence, preventMax);
+                    loses = attack <= std::max(defence, preventMin);
+                } else {
+                    int attack = strengthAgainst(m, owner(d));
+                    wins = attack > std::max(1, preventMax);
+                    loses = attack <= std::max(1, preventMin);
+                    if (units[d].status == 0) {
+                        wins = wins && full > preventMax;
+                        loses = loses && full <= preventMin;
+                    }
+                }
+                if (wins || loses) {
+                    unit.status = wins ? 1 : 2;
+                    progress = true;
+                } else {
+                    open = true;
+                }
+            }
+            if (progress || !open) continue;
+            // Stuck: what is left waits on units moving away. A ring of such moves that each
+            // win once their target is vacated all succeed; failing that, settle one as failed.
+            for (size_t m = 0; m < units.size() && !progress; m++) {
+                if (!units[m].attacks || units[m].status) continue;
+                route.clear();
+                for (size_t x = m; units[x].clearIfLeft && !units[x].mark;) {
+                    units[x].mark = 1;
+                    route.push_back(x);
+                    int d = unitIn(units[x].target->belonged);
+                    if (d < 0 || !units[d].attacks || units[d].status || headToHead(x, d)) break;
+                    if (size_t(d) == m) {
+                        for (uint r : route) units[r].status = 1;
+                        progress = true;
+                        break;
+                    }
+                    x = d;
+                }
+                for (uint r : route) units[r].mark = 0;
+            }
+            for (size_t m = 0; m < units.size() && !progress; m++) {
+                if (units[m].attacks && !units[m].status) {
+                    units[m].status = 2;
+                    progress = true;
+                }
+            }
+        }
+
+        bool settled = true;
+        for (size_t u = 0; u < units.size(); u++) {
+            bool dislodged = false;
+            if (!(units[u].attacks && units[u].status == 1)) {
+                auto [first, last] = movedInto(units[u].part->belonged->id);
+                dislodged = std::any_of(first, last, [&units](const auto& a) { return units[a.second].status == 1; });
+            }
+            settled = settled && dislodged == units[u].dislodged;
+            units[u].dislodged = dislodged;
+        }
+        if (settled || round == 2 * roundLimit) break;
+        if (round == roundLimit) paradox = true;
+    }
+
+    for (const Unit& unit : units) {
+        if (unit.attacks && unit.status == 1) resolution.moves.emplace_back(unit.part, unit.target);
+        if (!unit.dislodged) continue;
+        auto [first, last] = movedInto(unit.part->belonged->id);
+        auto winner = std::find_if(first, last, [&units](const auto& a) { return units[a.second].status == 1; });
+        const Unit& attacker = units[winner->second];
+        resolution.dislodged.push_back(unit.part);
+        resolution.attackedFrom.push_back(attacker.order == 'M' ? attacker.part->belonged : nullptr);
+    }
+    // A standoff leaves a territory empty: every move into it failed, not only one beaten
+    // head-to-head by the unit there, and that unit, if any, moved out.
+    for (auto it = arrivals.begin(); it != arrivals.end();) {
+        auto [first, last] = movedInto(it->first);
+        it = last;
+        Territory* territory = units[first->second].target->belonged;
+        int d = unitIn(territory);
+        bool vacated = d < 0 || (units[d].attacks && units[d].status == 1);
+        bool taken = std::any_of(first, last, [&units](const auto& a) { return units[a.second].status == 1; });
+        bool bounced = std::any_of(first, last, [&](const auto& a) { return !headToHead(a.second, d); });
+        if (vacated && !taken && bounced) resolution.standoffs.push_back(territory);
+    }
+}
+
+// Regions are resolved in parallel only on maps with enough units to pay for it; the board
+// is updated afterwards on this thread in region order, so the result never depends on
+// the thread count.
+void Game::movePhase() {
+    standoffs.clear();
+    orderRegions();
+    if (resolutions.size() < regionCount) resolutions.resize(regionCount);
+    size_t units = 0;
+    for (auto& player : allPlayers) {
+        units += player->units.size();
+    }
+    if (pool && units >= parallelThreshold && regionCount > 1) {
+        pool->parallelFor(regionCount, [&](size_t i) {
+            ScopedTrace trace("resolveRegion");
+            resolveMoves(regions[i], resolutions[i]);
+        });
+    } else {
+        for (size_t i = 0; i < regionCount; i++) {
+            ScopedTrace trace("resolveRegion");
+            resolveMoves(regions[i], resolutions[i]);
+        }
+    }
+    for (size_t i = 0; i < regionCount; i++) {
+        applyResolution(resolutions[i]);
+    }
+    for (auto& player : allPlayers) {
+        player->orders.clear();
+    }
+    if (!dislodgedUnits.empty()) {
+        phaseType = 1;
+    } else {
+        finishMovement();
+    }
+}
+
+// Centers change hands at the end of every buildTime-th move phase, after its retreats; a
+// build phase follows if some power now has more or fewer centers than units.
+void Game::finishMovement() {
+    if (buildTime && phaseCount % buildTime == 0) {
+        updateCenters();
+        bool adjusting = std::any_of(allPlayers.begin() + 1, allPlayers.end(),
+            [](const auto& player) { return player->centerCount != int(player->units.size()); });
+        if (adjusting) {
+            phaseType = 2;
+            return;
+        }
+    }
+    phaseType = 0;
+    phaseCount++;
+}
+
+// An occupied center goes to the occupier; with allCenters every owned center is a build site.
+void Game::updateCenters() {
+    for (auto& territory : allTerritories) {
+        if (!territory->center) continue;
+        Player* occupier = nullptr;
+        for (const auto& part : territory->parts) {
+            if (part->unit) occupier = part->unit;
+        }
+        if (!occupier || occupier == territory->owner) continue;
+        Player* previous = territory->owner;
+        if (previous) {
+            previous->centerCount--;
+            if (buildRule == 1) {
+                previous->allowBuild.erase(std::find(previous->allowBuild.begin(), previous->allowBuild.end(), territory.get()));
+            }
+        }
+        territory->owner = occupier;
+        occupier->centerCount++;
+        if (buildRule == 1) occupier->allowBuild.push_back(territory.get());
+    }
+}
+
+// A dislodged unit may retreat into an empty neighbor, except the territory its attacker came
+// from and any left empty by a standoff.
+bool Game::canRetreat(size_t dislodged, const Part* target) const {
+    const Territory* territory = target->belonged;
+    bool empty = std::none_of(territory->parts.begin(), territory->parts.end(), [](const auto& p) { return p->unit; });
+    return empty && territory != dislodgedFrom[dislodged]
+        && std::find(standoffs.begin(), standoffs.end(), territory) == standoffs.end();
+}
+
+// A retreat succeeds into a territory canRetreat allows that no other unit retreats into; a
+// unit without one is disbanded.
+void Game::retreatPhase() {
+    std::vector<Part*> targets(dislodgedUnits.size(), nullptr);
+    for (size_t i = 0; i < dislodgedUnits.size(); i++) {
+        const auto& [part, player] = dislodgedUnits[i];
+        for (const auto& order : player->orders) {
+            std::string_view words(order);
+            if (words.substr(0, words.find(' ')) != part->name || words.size() < part->name.size() + 4
+                || words.substr(part->name.size(), 3) != " R ") continue;
+            Part* target = findPart(words.substr(part->name.size() + 3));
+            bool adjacent = target && std::find(part->neighbors.begin(), part->neighbors.end(), target) != part->neighbors.end();
+            if (adjacent && canRetreat(i, target)) targets[i] = target;
+        }
+    }
+    for (size_t i = 0; i < dislodgedUnits.size(); i++) {
+        Player* player = dislodgedUnits[i].second;
+        bool bounced = targets[i] && std::count_if(targets.begin(), targets.end(), [&](const Part* other) {
+            return other && other->belonged == targets[i]->belonged;
+        }) > 1;
+        if (targets[i] && !bounced) {
+            placeUnit(targets[i], player);
+        } else {
+            player->unitCount--;
+        }
+    }
+    dislodgedUnits.clear();
+    dislodgedFrom.clear();
+    standoffs.clear();
+    for (auto& player : allPlayers) {
+        player->orders.clear();
+    }
+    finishMovement();
+}
+
+// Builds and disbands are taken in order up to each power's difference; a power that
+// disbands too few loses its most recently placed units.
+void Game::buildPhase() {
+    for (size_t i = 1; i < allPlayers.size(); i++) {
+        Player* player = allPlayers[i].get();
+        int difference = player->centerCount - int(player->units.size());
+        for (const auto& order : player->orders) {
+            if (difference == 0) break;
+            std::string_view words(order);
+            Part* part = findPart(words.substr(0, words.find(' ')));
+            char type = words.back();
+            if (!part) continue;
+            if (type == 'B' && difference > 0) {
+                bool free = std::none_of(part->belonged->parts.begin(), part->belonged->parts.end(),
+                    [](const auto& p) { return p->unit; });
+                bool home = std::find(player->allowBuild.begin(), player->allowBuild.end(), part->belonged) != player->allowBuild.end();
+                if (free && home && part->belonged->owner == player) {
+                    placeUnit(part, player);
                     player->unitCount++;
+                    difference--;
                 }
-                
-                if (territory->center) {
-                    territory->owner = player;
-                    player->centerCount++;
-                    player->allowBuild.push_back(territory.get());
+            } else if (type == 'D' && difference < 0 && part->unit == player) {
+                liftUnit(part);
+                player->unitCount--;
+                difference++;
+            }
+        }
+        for (; difference < 0; difference++) {
+            liftUnit(player->units.back());
+            player->unitCount--;
+        }
+        player->orders.clear();
+    }
+    phaseType = 0;
+    phaseCount++;
+}
+
+// A power reaching winCondition centers wins outright; otherwise the game is drawn once every
+// power still holding units or centers votes for it, split equally (DSS) or by centers
+// squared (SoS). With voteShown each power's vote is output after every phase.
+void Game::checkVotes() {
+    verdict.clear();
+    std::vector<Player*> alive;
+    for (size_t i = 1; i < allPlayers.size(); i++) {
+        Player* player = allPlayers[i].get();
+        if (player->unitCount || player->centerCount) alive.push_back(player);
+        if (player->centerCount >= int(winCondition)) {
+            verdict = "Result solo " + player->name + "\n";
+            finished = true;
+            return;
+        }
+    }
+    if (voteShown) {
+        for (Player* player : alive) verdict += player->name + " vote " + (player->vote ? "1" : "0") + "\n";
+    }
+    if (alive.empty() || !std::all_of(alive.begin(), alive.end(), [](const Player* p) { return p->vote; })) return;
+    double total = 0;
+    for (Player* player : alive) total += drawType == 0 ? 1.0 : double(player->centerCount) * player->centerCount;
+    verdict += "Result draw";
+    for (Player* player : alive) {
+        double share = drawType == 0 ? 1.0 : double(player->centerCount) * player->centerCount;
+        verdict += " " + player->name + " " + json(total > 0 ? share / total : 0.0).dump();
+    }
+    verdict += "\n";
+    finished = true;
+}
+
+// Reads std input on this thread without blocking the deadline wheel, which ticks every
+// second between reads. Phase and map output follow every phase change.
+void Game::play() {
+    TimerWheel timers(std::chrono::seconds(1));
+    attachTimer(timers);
+    std::string pending;
+    uint shownCount = 0;
+    unsigned char shownType = 0;
+    while (!finished) {
+        std::shared_ptr<const StateSnapshot> state = snapshot();
+        if (state->phaseCount != shownCount || state->phaseType != shownType) {
+            std::cout << state->result << state->phase;
+            state->writeMap(std::cout);
+            std::cout << std::endl;
+            shownCount = state->phaseCount;
+            shownType = state->phaseType;
+        }
+        pollfd input{STDIN_FILENO, POLLIN, 0};
+        if (::poll(&input, 1, 100) > 0) {
+            char buffer[4096];
+            ssize_t received = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (received <= 0) break;
+            pending.append(buffer, received);
+            for (size_t end; (end = pending.find('\n')) != std::string::npos; pending.erase(0, end + 1)) {
+                submit(pending.substr(0, end));
+            }
+        }
+        drain();
+        timers.advance(std::chrono::steady_clock::now());
+    }
+    std::cout << snapshot()->result << std::flush;
+    timers.cancel(deadline);
+    wheel = nullptr;
+}
+
+// Runs the current phase, either on deadline expiry or early once every player is ready.
+void Game::adjudicate() {
+    ScopedTrace trace("adjudicate");
+    AllocScope counter(allocations[adjudicateAllocations]);
+    if (wheel) wheel->cancel(deadline);
+    writeLog();
+    {
+        AllocScope phaseCounter(allocations[phaseAllocations]);
+        ScopedLatency timer(latency[phaseType == 0 ? moveLatency : phaseType == 1 ? retreatLatency : buildLatency]);
+        ScopedTrace phaseTrace(phaseType == 0 ? "movePhase" : phaseType == 1 ? "retreatPhase" : "buildPhase");
+        switch (phaseType) {
+            case 0: movePhase(); break;
+            case 1: retreatPhase(); break;
+            default: buildPhase(); break;
+        }
+    }
+    {
+        ScopedLatency timer(latency[votesLatency]);
+        ScopedTrace votesTrace("checkVotes");
+        checkVotes();
+    }
+    {
+        ScopedTrace spillTrace("pressSpill");
+        press.spill(press.readFloor(), pressFilePath);
+    }
+    resetReady();
+    publishSnapshot();
+    if (wheel) attachTimer(*wheel);
+}
+
+// Centers the power would stand on count, new ones triple; losing units costs more than
+// dislodging enemies gains, and standing where enemies could bring more support than the
+// power is a small penalty.
+double BeamSearchBot::evaluate(const Player* power, const Resolution& resolution) const {
+    double score = 0;
+    auto standing = [&](const Part* part) {
+        const Territory* territory = part->belonged;
+        if (territory->center) score += territory->owner == power ? 1.0 : 3.0;
+        int own = 0, enemy = 0;
+        for (const InfluenceMap::Entry& entry : game.influence.at(part)) {
+            if (entry.player == power->id) {
+                own = entry.support;
+            } else {
+                enemy = std::max<int>(enemy, entry.support);
+            }
+        }
+        if (enemy > own) score -= 0.5;
+    };
+    for (const Part* unit : power->units) {
+        bool moved = false;
+        for (const auto& [from, to] : resolution.moves) {
+            if (from == unit) {
+                standing(to);
+                moved = true;
+            }
+        }
+        bool dislodged = std::find(resolution.dislodged.begin(), resolution.dislodged.end(), unit) != resolution.dislodged.end();
+        if (dislodged) score -= 4.0;
+        if (!moved && !dislodged) standing(unit);
+    }
+    for (const Part* part : resolution.dislodged) {
+        if (part->unit != power) score += 1.0;
+    }
+    return score;
+}
+
+SearchBudget BeamSearchBot::phaseBudget(std::chrono::milliseconds margin) const {
+    SearchBudget budget;
+    if (game.phaseEnds != std::chrono::steady_clock::time_point::max()) budget.deadline = game.phaseEnds - margin;
+    return budget;
+}
+
+static uint64_t threadCpuNanoseconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return uint64_t(now.tv_sec) * 1000000000 + uint64_t(now.tv_nsec);
+}
+
+SearchResult BeamSearchBot::search(const Player* power, const BeamOptions& options, const SearchBudget& budget) const {
+    ScopedTrace trace("beamSearch");
+    auto start = std::chrono::steady_clock::now();
+    SearchResult result;
+    if (game.phaseType != 0 || power->units.empty()) {
+        result.complete = true;
+        return result;
+    }
+
+    // Territories within two moves of the power's units.
+    std::vector<char> relevant(game.allTerritories.size(), 0);
+    Region region;
+    auto mark = [&](Territory* territory) {
+        if (!relevant[territory->id]) {
+            relevant[territory->id] = 1;
+            region.territories.push_back(territory);
+        }
+    };
+    for (Part* unit : power->units) {
+        mark(unit->belonged);
+        for (Part* near : unit->neighbors) {
+            mark(near->belonged);
+            for (const auto& part : near->belonged->parts) {
+                for (Part* far : part->neighbors) mark(far->belonged);
+            }
+        }
+    }
+
+    // Candidate orders per power unit and per nearby opponent unit, grouped by the unit's part.
+    using Orders = std::vector<std::pmr::string>;
+    auto byUnit = [](const std::vector<std::string>& legal) {
+        std::unordered_map<std::string_view, Orders> grouped;
+        for (const std::string& order : legal) {
+            std::string_view unit(order);
+            grouped[unit.substr(0, unit.find(' '))].emplace_back(order);
+        }
+        return grouped;
+    };
+    auto rank = [](const std::pmr::string& order) {
+        char type = order[order.find(' ') + 1];
+        return type == 'H' ? 0 : type == 'M' ? 1 : 2;
+    };
+    std::vector<std::string> ownLegal = game.legalOrders(power);
+    auto ownGrouped = byUnit(ownLegal);
+    std::vector<Part*> units(power->units.begin(), power->units.end());
+    auto pressure = [&](const Part* unit) {
+        int enemy = 0;
+        for (const InfluenceMap::Entry& entry : game.influence.at(unit)) {
+            if (entry.player != power->id) enemy += entry.threat;
+        }
+        return enemy;
+    };
+    std::stable_sort(units.begin(), units.end(), [&](const Part* a, const Part* b) { return pressure(a) > pressure(b); });
+    std::vector<Orders> candidates; // per unit that has any, in search order
+    std::vector<const Part*> candidateUnits; // the unit each candidates entry orders
+    for (Part* unit : units) {
+        Orders orders = ownGrouped[unit->name];
+        if (orders.empty()) continue;
+        std::stable_sort(orders.begin(), orders.end(), [&](const auto& a, const auto& b) { return rank(a) < rank(b); });
+        if (orders.size() > options.candidatesPerUnit) orders.resize(options.candidatesPerUnit);
+        candidates.push_back(std::move(orders));
+        candidateUnits.push_back(unit);
+    }
+
+    std::mt19937 rng(options.seed);
+    std::vector<std::vector<const std::pmr::string*>> samples(std::max<size_t>(1, options.samples));
+    std::unordered_map<const Player*, std::vector<std::string>> opponentLegal; // grouped views point into these
+    std::unordered_map<const Player*, std::unordered_map<std::string_view, Orders>> opponentGrouped;
+    std::vector<const Orders*> opponentCandidates;
+    for (Territory* territory : region.territories) {
+        for (const auto& part : territory->parts) {
+            if (!part->unit || part->unit == power) continue;
+            auto it = opponentGrouped.find(part->unit);
+            if (it == opponentGrouped.end()) {
+                const auto& legal = opponentLegal.emplace(part->unit, game.legalOrders(part->unit)).first->second;
+                it = opponentGrouped.emplace(part->unit, byUnit(legal)).first;
+            }
+            opponentCandidates.push_back(&it->second[part->name]);
+        }
+    }
+    for (auto& sample : samples) {
+        for (const Orders* orders : opponentCandidates) {
+            if (!orders->empty()) sample.push_back(&(*orders)[rng() % orders->size()]);
+        }
+    }
+
+    // A beam entry chooses one candidate index per unit decided so far.
+    struct Entry {
+        std::vector<uint> choices;
+        double score;
+    };
+    std::atomic<uint64_t> nodes{0};
+    std::atomic<uint64_t> cpuUsed{0};
+    std::atomic<bool> stopped{false};
+    auto expired = [&]() {
+        if (stopped.load(std::memory_order_relaxed)) return true;
+        bool over = (budget.cancel && budget.cancel->load(std::memory_order_relaxed))
+            || std::chrono::steady_clock::now() >= budget.deadline
+            || cpuUsed.load(std::memory_order_relaxed) >= uint64_t(budget.cpu.count());
+        if (over) stopped.store(true, std::memory_order_relaxed);
+        return over;
+    };
+
+    const double unscored = -std::numeric_limits<double>::infinity();
+    std::vector<Entry> beam{{{}, unscored}};
+    for (size_t u = 0; u < candidates.size() && !expired(); u++) {
+        std::vector<Entry> expanded;
+        for (const Entry& entry : beam) {
+            for (uint c = 0; c < candidates[u].size(); c++) {
+                Entry next{entry.choices, unscored};
+                next.choices.push_back(c);
+                expanded.push_back(std::move(next));
+            }
+        }
+        auto score = [&](size_t i) {
+            if (expired()) return;
+            uint64_t cpuStart = threadCpuNanoseconds();
+            Entry& entry = expanded[i];
+            Region trial;
+            trial.territories = region.territories;
+            Resolution resolution;
+            double total = 0;
+            for (const auto& sample : samples) {
+                trial.orders.clear();
+                for (size_t k = 0; k < entry.choices.size(); k++) trial.orders.push_back(&candidates[k][entry.choices[k]]);
+                trial.orders.insert(trial.orders.end(), sample.begin(), sample.end());
+                game.resolveMoves(trial, resolution);
+                total += evaluate(power, resolution);
+            }
+            entry.score = total / double(samples.size());
+            nodes.fetch_add(1, std::memory_order_relaxed);
+            cpuUsed.fetch_add(threadCpuNanoseconds() - cpuStart, std::memory_order_relaxed);
+        };
+        if (game.pool && expanded.size() > 1) {
+            game.pool->parallelFor(expanded.size(), score);
+        } else {
+            for (size_t i = 0; i < expanded.size(); i++) score(i);
+        }
+        // Ties keep expansion order so the result does not depend on the thread count.
+        std::stable_sort(expanded.begin(), expanded.end(), [](const Entry& a, const Entry& b) { return a.score > b.score; });
+        if (expired()) {
+            // Every scored set is complete and scored on the same samples, so a cut level
+            // still replaces the beam's best if it found a better set.
+            if (expanded[0].score > beam[0].score) beam[0] = expanded[0];
+            break;
+        }
+        if (expanded.size() > options.width) expanded.resize(options.width);
+        beam = std::move(expanded);
+    }
+    // Units the search did not reach, including all of them when it was cut before its first
+    // node, get an explicit hold so the result always orders every unit.
+    size_t decided = beam[0].choices.size();
+    for (size_t k = 0; k < decided; k++) {
+        result.orders.emplace_back(candidates[k][beam[0].choices[k]]);
+    }
+    for (const Part* unit : units) {
+        if (std::find(candidateUnits.begin(), candidateUnits.begin() + decided, unit) == candidateUnits.begin() + decided) {
+            result.orders.push_back(unit->name + " H");
+        }
+    }
+    result.complete = !stopped.load();
+    result.nodes = nodes.load();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.nodesPerSecond = result.seconds > 0 ? double(result.nodes) / result.seconds : 0;
+    return result;
+}
+
+// Symmetric int8 quantization of n values (widened to int16), returning the scale that maps back.
+static float quantizeRow(const float* values, size_t n, int16_t* out) {
+    float largest = 0;
+    for (size_t i = 0; i < n; i++) largest = std::max(largest, std::fabs(values[i]));
+    float scale = largest > 0 ? largest / 127.0f : 1.0f;
+    float inverse = 1.0f / scale;
+    for (size_t i = 0; i < n; i++) out[i] = int16_t(std::nearbyint(values[i] * inverse));
+    return scale;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static bool cpuHasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+// The 64-column kernels, compiled for AVX2 and FMA by attribute so a default build carries
+// them too; only called once cpuHasAvx2() says the CPU runs them. w is the block's first
+// weight and stride the step to the next input's.
+__attribute__((target("avx2,fma")))
+static void blockF32Avx2(const float* in, size_t inputs, const float* w, size_t stride, float* sums) {
+    __m256 lanes[8];
+    for (auto& lane : lanes) lane = _mm256_setzero_ps();
+    for (size_t k = 0; k < inputs; k++, w += stride) {
+        __m256 a = _mm256_set1_ps(in[k]);
+        for (int j = 0; j < 8; j++) lanes[j] = _mm256_fmadd_ps(a, _mm256_loadu_ps(w + 8 * j), lanes[j]);
+    }
+    for (int j = 0; j < 8; j++) _mm256_storeu_ps(sums + 8 * j, lanes[j]);
+}
+
+__attribute__((target("avx2")))
+static void blockI8Avx2(const int16_t* in, size_t inputPairs, const int16_t* w, size_t stride, int32_t* sums) {
+    __m256i lanes[8];
+    for (auto& lane : lanes) lane = _mm256_setzero_si256();
+    for (size_t p = 0; p < inputPairs; p++, w += stride) {
+        int32_t pair = int32_t(uint16_t(in[2 * p])) | int32_t(uint32_t(uint16_t(in[2 * p + 1])) << 16);
+        __m256i a = _mm256_set1_epi32(pair);
+        for (int j = 0; j < 8; j++) {
+            __m256i weight = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + 16 * j));
+            lanes[j] = _mm256_add_epi32(lanes[j], _mm256_madd_epi16(a, weight));
+        }
+    }
+    for (int j = 0; j < 8; j++) _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + 8 * j), lanes[j]);
+}
+#else
+static bool cpuHasAvx2() { return false; }
+#endif
+
+DenseWeights::DenseWeights(size_t inputs, size_t outputs, std::vector<float> weights, std::vector<float> bias)
+    : inputCount(inputs), outputCount(outputs), avx2(cpuHasAvx2()), bias(std::move(bias)) {
+    if (weights.size() != inputs * outputs || this->bias.size() != outputs) {
+        throw std::runtime_error("Layer weights do not match " + std::to_string(inputs) + " inputs x "
+            + std::to_string(outputs) + " outputs");
+    }
+    transposed.resize(inputs * outputs);
+    for (size_t n = 0; n < outputs; n++) {
+        for (size_t k = 0; k < inputs; k++) transposed[k * outputs + n] = weights[n * inputs + k];
+    }
+}
+
+void DenseWeights::quantize() {
+    size_t inputPairs = (inputCount + 1) / 2;
+    pairs.assign(inputPairs * outputCount * 2, 0);
+    scales.resize(outputCount);
+    std::vector<float> column(inputCount);
+    std::vector<int16_t> row(inputPairs * 2, 0);
+    for (size_t n = 0; n < outputCount; n++) {
+        for (size_t k = 0; k < inputCount; k++) column[k] = transposed[k * outputCount + n];
+        scales[n] = quantizeRow(column.data(), inputCount, row.data());
+        for (size_t k = 0; k < inputCount; k++) pairs[((k / 2) * outputCount + n) * 2 + k % 2] = row[k];
+    }
+}
+
+// sums[n] = in . weights[first + n] for one input row.
+void DenseWeights::blockF32(const float* in, size_t first, size_t columns, float* sums) const {
+#if defined(__x86_64__) || defined(__i386__)
+    if (avx2 && columns == blockColumns) {
+        blockF32Avx2(in, inputCount, transposed.data() + first, outputCount, sums);
+        return;
+    }
+#endif
+    for (size_t n = 0; n < columns; n++) sums[n] = 0;
+    for (size_t k = 0; k < inputCount; k++) {
+        float a = in[k];
+        const float* w = transposed.data() + k * outputCount + first;
+        for (size_t n = 0; n < columns; n++) sums[n] += a * w[n];
+    }
+}
+
+// Same over int8 values: each step multiplies one input pair into every output with one
+// 16-bit multiply-add, accumulating in int32.
+void DenseWeights::blockI8(const int16_t* in, size_t first, size_t columns, int32_t* sums) const {
+    size_t inputPairs = (inputCount + 1) / 2;
+#if defined(__x86_64__) || defined(__i386__)
+    if (avx2 && columns == blockColumns) {
+        blockI8Avx2(in, inputPairs, pairs.data() + first * 2, outputCount * 2, sums);
+        return;
+    }
+#endif
+    for (size_t n = 0; n < columns; n++) sums[n] = 0;
+    for (size_t p = 0; p < inputPairs; p++) {
+        int32_t a0 = in[2 * p], a1 = in[2 * p + 1];
+        const int16_t* w = pairs.data() + (p * outputCount + first) * 2;
+        for (size_t n = 0; n < columns; n++) sums[n] += a0 * w[2 * n] + a1 * w[2 * n + 1];
+    }
+}
+
+void DenseWeights::apply(const float* in, size_t rows, float* out, bool accumulate) const {
+    const bool int8 = !pairs.empty();
+    const size_t width = (inputCount + 1) / 2 * 2;
+    std::vector<int16_t> inputs;
+    std::vector<float> inputScales;
+    if (int8) {
+        inputs.assign(rows * width, 0);
+        inputScales.resize(rows);
+        for (size_t m = 0; m < rows; m++) {
+            inputScales[m] = quantizeRow(in + m * inputCount, inputCount, inputs.data() + m * width);
+        }
+    }
+    float sums[blockColumns];
+    int32_t integerSums[blockColumns];
+    for (size_t first = 0; first < outputCount; first += blockColumns) {
+        size_t columns = std::min(blockColumns, outputCount - first);
+        for (size_t m = 0; m < rows; m++) {
+            if (int8) {
+                blockI8(inputs.data() + m * width, first, columns, integerSums);
+                for (size_t n = 0; n < columns; n++) sums[n] = float(integerSums[n]) * inputScales[m] * scales[first + n];
+            } else {
+                blockF32(in + m * inputCount, first, columns, sums);
+            }
+            float* row = out + m * outputCount + first;
+            for (size_t n = 0; n < columns; n++) row[n] = (accumulate ? row[n] : bias[first + n]) + sums[n];
+        }
+    }
+}
+
+InferenceNetwork::InferenceNetwork(const std::string& path, PartGraph graph) : graph(std::move(graph)) {
+    std::ifstream file(path);
+    if (!file) throw std::runtime_error("Cannot open " + path);
+    json network = json::parse(file);
+    features = network.at("features");
+    size_t width = features;
+    bool pooled = false;
+    auto matrix = [](const json& rows, size_t& columns) {
+        std::vector<float> values;
+        columns = rows.empty() ? 0 : rows[0].size();
+        for (const auto& row : rows) {
+            if (row.size() != columns) throw std::runtime_error("Ragged weight rows");
+            for (const auto& value : row) values.push_back(value.get<float>());
+        }
+        return values;
+    };
+    for (const auto& layerJson : network.at("layers")) {
+        Layer layer;
+        std::string type = layerJson.at("type");
+        layer.relu = layerJson.value("activation", "none") == "relu";
+        if (type == "meanPool") {
+            if (pooled) throw std::runtime_error("Network pools twice");
+            layer.kind = Layer::meanPool;
+            pooled = true;
+            layers.push_back(std::move(layer));
+            continue;
+        }
+        size_t columns = 0;
+        std::vector<float> bias = layerJson.at("bias").get<std::vector<float>>();
+        if (type == "graphConv") {
+            if (pooled) throw std::runtime_error("graphConv after meanPool");
+            layer.kind = Layer::graphConv;
+            layer.self = std::make_unique<DenseWeights>(width, bias.size(), matrix(layerJson.at("self"), columns), bias);
+            if (columns != width) throw std::runtime_error("graphConv expects " + std::to_string(width) + " inputs");
+            layer.neighbor = std::make_unique<DenseWeights>(width, bias.size(), matrix(layerJson.at("neighbor"), columns),
+                std::vector<float>(bias.size(), 0.0f));
+        } else if (type == "dense") {
+            layer.kind = Layer::dense;
+            layer.self = std::make_unique<DenseWeights>(width, bias.size(), matrix(layerJson.at("weights"), columns), bias);
+        } else {
+            throw std::runtime_error("Unknown layer type " + type);
+        }
+        if (columns != width) throw std::runtime_error(type + " expects " + std::to_string(width) + " inputs");
+        width = bias.size();
+        layers.push_back(std::move(layer));
+    }
+    outputs = pooled ? width : width * (this->graph.offsets.size() - 1);
+}
+
+void InferenceNetwork::quantize() {
+    for (Layer& layer : layers) {
+        if (layer.self) layer.self->quantize();
+        if (layer.neighbor) layer.neighbor->quantize();
+    }
+}
+
+void InferenceNetwork::evaluate(const float* inputs, size_t batch, float* results) const {
+    ScopedTrace trace("inference");
+    const size_t parts = graph.offsets.size() - 1;
+    size_t rows = batch * parts, width = features;
+    std::vector<float> current(inputs, inputs + rows * width), next, gathered;
+    for (const Layer& layer : layers) {
+        if (layer.kind == Layer::meanPool) {
+            next.assign(batch * width, 0.0f);
+            for (size_t b = 0; b < batch; b++) {
+                for (size_t v = 0; v < parts; v++) {
+                    const float* row = current.data() + (b * parts + v) * width;
+                    for (size_t f = 0; f < width; f++) next[b * width + f] += row[f];
                 }
+                for (size_t f = 0; f < width; f++) next[b * width + f] /= float(std::max<size_t>(1, parts));
+            }
+            rows = batch;
+        } else {
+            size_t outputWidth = layer.self->outputs();
+            next.resize(rows * outputWidth);
+            layer.self->apply(current.data(), rows, next.data(), false);
+            if (layer.kind == Layer::graphConv) {
+                gathered.assign(rows * width, 0.0f);
+                for (size_t b = 0; b < batch; b++) {
+                    for (size_t v = 0; v < parts; v++) {
+                        float* mean = gathered.data() + (b * parts + v) * width;
+                        uint first = graph.offsets[v], last = graph.offsets[v + 1];
+                        for (uint e = first; e < last; e++) {
+                            const float* row = current.data() + (b * parts + graph.neighbors[e]) * width;
+                            for (size_t f = 0; f < width; f++) mean[f] += row[f];
+                        }
+                        if (last > first) {
+                            for (size_t f = 0; f < width; f++) mean[f] /= float(last - first);
+                        }
+                    }
+                }
+                layer.neighbor->apply(gathered.data(), rows, next.data(), true);
+            }
+            if (layer.relu) {
+                for (float& value : next) value = std::max(value, 0.0f);
+            }
+            width = outputWidth;
+        }
+        current.swap(next);
+    }
+    std::copy(current.begin(), current.end(), results);
+}
+
+InferenceQueue::InferenceQueue(const InferenceNetwork& network, size_t maxBatch, std::chrono::microseconds maxDelay)
+    : network(network), maxBatch(std::max<size_t>(1, maxBatch)), maxDelay(maxDelay) {
+    worker = std::thread([this]() { run(); });
+}
+
+InferenceQueue::~InferenceQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+std::future<std::vector<float>> InferenceQueue::submit(std::vector<float> input) {
+    if (input.size() != network.inputSize()) {
+        throw std::runtime_error("Inference input has " + std::to_string(input.size()) + " values, expected "
+            + std::to_string(network.inputSize()));
+    }
+    Request request{std::move(input), {}, std::chrono::steady_clock::now()};
+    std::future<std::vector<float>> result = request.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(request));
+    }
+    wake.notify_one();
+    return result;
+}
+
+// Waits for a first request, then for the batch to fill or the first request's delay to run
+// out; pending requests are answered before the thread exits.
+void InferenceQueue::run() {
+    std::vector<Request> batch;
+    std::vector<float> inputs, results;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+            if (pending.empty()) return;
+            auto due = pending.front().arrived + maxDelay;
+            wake.wait_until(lock, due, [this]() { return stopping || pending.size() >= maxBatch; });
+            size_t count = std::min(maxBatch, pending.size());
+            batch.clear();
+            for (size_t i = 0; i < count; i++) {
+                batch.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+        }
+        size_t inputSize = network.inputSize(), outputSize = network.outputSize();
+        inputs.resize(batch.size() * inputSize);
+        results.resize(batch.size() * outputSize);
+        for (size_t i = 0; i < batch.size(); i++) {
+            std::copy(batch[i].input.begin(), batch[i].input.end(), inputs.begin() + i * inputSize);
+        }
+        try {
+            network.evaluate(inputs.data(), batch.size(), results.data());
+            for (size_t i = 0; i < batch.size(); i++) {
+                batch[i].result.set_value(std::vector<float>(results.begin() + i * outputSize,
+                    results.begin() + (i + 1) * outputSize));
+            }
+        } catch (...) {
+            for (Request& request : batch) request.result.set_exception(std::current_exception());
+        }
+    }
+}
+
+namespace {
+// DAIDE token values used by the server, from the DAIDE message syntax.
+enum : uint16_t {
+    BRA = 0x4000, KET = 0x4001,
+    AMY = 0x4200, FLT = 0x4201,
+    CTO = 0x4320, CVY = 0x4321, HLD = 0x4322, MTO = 0x4323, SUP = 0x4324, VIA = 0x4325,
+    DSB = 0x4340, RTO = 0x4341, BLD = 0x4380, REM = 0x4381, WVE = 0x4382,
+    MBV = 0x4400,
+    SPR = 0x4702, SUM = 0x4703, FAL = 0x4701, AUT = 0x4700, WIN = 0x4704,
+    DRW = 0x4801, FRM = 0x4802, GOF = 0x4803, HLO = 0x4804, HUH = 0x4806, IAM = 0x4807,
+    MAP = 0x4809, MDF = 0x480A, NME = 0x480C, NOT = 0x480D, NOW = 0x480E, OBS = 0x480F,
+    OFF = 0x4810, REJ = 0x4814, SCO = 0x4815, SND = 0x4817, SUB = 0x4818, THX = 0x481A,
+    TME = 0x481B, YES = 0x481C,
+    UNO = 0x4C0B,
+    TEXT = 0x4B00, POWER = 0x4100
+};
+
+const std::pair<uint16_t, const char*> daideNames[] = {
+    {BRA, "("}, {KET, ")"}, {AMY, "AMY"}, {FLT, "FLT"},
+    {CTO, "CTO"}, {CVY, "CVY"}, {HLD, "HLD"}, {MTO, "MTO"}, {SUP, "SUP"}, {VIA, "VIA"},
+    {DSB, "DSB"}, {RTO, "RTO"}, {BLD, "BLD"}, {REM, "REM"}, {WVE, "WVE"}, {MBV, "MBV"},
+    {0x4600, "NCS"}, {0x4602, "NEC"}, {0x4604, "ECS"}, {0x4606, "SEC"},
+    {0x4608, "SCS"}, {0x460A, "SWC"}, {0x460C, "WCS"}, {0x460E, "NWC"},
+    {SPR, "SPR"}, {SUM, "SUM"}, {FAL, "FAL"}, {AUT, "AUT"}, {WIN, "WIN"},
+    {DRW, "DRW"}, {FRM, "FRM"}, {GOF, "GOF"}, {HLO, "HLO"}, {HUH, "HUH"}, {IAM, "IAM"},
+    {MAP, "MAP"}, {MDF, "MDF"}, {NME, "NME"}, {NOT, "NOT"}, {NOW, "NOW"}, {OBS, "OBS"},
+    {OFF, "OFF"}, {REJ, "REJ"}, {SCO, "SCO"}, {SND, "SND"}, {SUB, "SUB"}, {THX, "THX"},
+    {TME, "TME"}, {YES, "YES"}, {UNO, "UNO"}
+};
+
+// Map part suffixes for split coasts to DAIDE coast tokens.
+const std::pair<const char*, uint16_t> daideCoasts[] = {
+    {"NC", 0x4600}, {"NEC", 0x4602}, {"EC", 0x4604}, {"SEC", 0x4606},
+    {"SC", 0x4608}, {"SWC", 0x460A}, {"WC", 0x460C}, {"NWC", 0x460E}
+};
+
+enum : unsigned char { IM = 0, RM = 1, DM = 2, FM = 3, EM = 4 };
+}
+
+size_t DaideTokens::skip(size_t at) const {
+    if ((*this)[at] != BRA) return at + 1;
+    int depth = 0;
+    for (size_t i = at; i < count; i++) {
+        depth += (*this)[i] == BRA ? 1 : (*this)[i] == KET ? -1 : 0;
+        if (depth == 0) return i + 1;
+    }
+    throw std::runtime_error("Unbalanced DAIDE brackets");
+}
+
+DaideTokens DaideTokens::group(size_t at) const {
+    if (at >= count || (*this)[at] != BRA) throw std::runtime_error("Expected DAIDE bracket");
+    return slice(at + 1, skip(at) - 1);
+}
+
+// Province tokens encode inland/sea/coastal, supply centre and split coasts in the category
+// byte and the territory index in the low byte, so one server supports up to 256 provinces.
+DaideServer::DaideServer(Game& game, uint16_t port)
+    : game(game), running(false), lastPhaseCount(0), lastPhaseType(0) {
+    if (game.allTerritories.size() > 256 || game.allPlayers.size() > 256) {
+        throw std::runtime_error("Map too large for DAIDE tokens");
+    }
+    for (const auto& [token, name] : daideNames) {
+        tokenNames[token] = name;
+        nameTokens[name] = token;
+    }
+    powerTokens.push_back(UNO);
+    for (size_t i = 1; i < game.allPlayers.size(); i++) {
+        powerTokens.push_back(uint16_t(POWER | (i - 1)));
+    }
+    for (size_t i = 0; i < game.allTerritories.size(); i++) {
+        Territory* territory = game.allTerritories[i].get();
+        int land = 0, coasts = 0;
+        for (auto& part : territory->parts) {
+            (part->LC ? coasts : land)++;
+        }
+        uint16_t category = !coasts ? 0x50 : !land ? 0x52 : coasts == 1 ? 0x54 : 0x56;
+        uint16_t token = uint16_t((category + (territory->center ? 1 : 0)) << 8 | i);
+        provinceTokens.push_back(token);
+        provinces[token] = territory;
+    }
+    for (size_t i = 1; i < game.allPlayers.size(); i++) {
+        tokenNames[powerTokens[i]] = game.allPlayers[i]->name.substr(0, 3);
+    }
+    for (size_t i = 0; i < game.allTerritories.size(); i++) {
+        tokenNames[provinceTokens[i]] = game.allTerritories[i]->name.substr(0, 3);
+    }
+    for (size_t i = 1; i < powerTokens.size(); i++) nameTokens[tokenNames[powerTokens[i]]] = powerTokens[i];
+    for (uint16_t token : provinceTokens) nameTokens[tokenNames[token]] = token;
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        throw std::runtime_error("Failed to open DAIDE socket");
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 16) < 0) {
+        close(listener);
+        throw std::runtime_error("Failed to listen on DAIDE port " + std::to_string(port));
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+}
+
+DaideServer::~DaideServer() {
+    for (auto& client : clients) {
+        game.unsubscribePress(client->press);
+        close(client->socket);
+    }
+    close(listener);
+}
+
+void DaideServer::run() {
+    running = true;
+    while (running) {
+        poll(100);
+    }
+}
+
+// Output queued during the poll is written at its end as far as each socket takes it; the
+// rest waits for POLLOUT.
+void DaideServer::poll(int timeoutMs) {
+    std::vector<pollfd> sockets{{listener, POLLIN, 0}};
+    for (auto& client : clients) {
+        sockets.push_back({client->socket, short(client->output.empty() ? POLLIN : POLLIN | POLLOUT), 0});
+    }
+    if (::poll(sockets.data(), sockets.size(), timeoutMs) > 0) {
+        for (size_t i = clients.size(); i > 0; i--) {
+            short events = sockets[i].revents;
+            bool open = !(events & (POLLIN | POLLHUP | POLLERR)) || receive(*clients[i - 1]);
+            if (open && (events & POLLOUT)) open = flush(*clients[i - 1]);
+            if (!open) drop(i - 1);
+        }
+        if (sockets[0].revents & POLLIN) accept();
+    }
+    game.drain();
+    bool phaseChanged = game.phaseCount != lastPhaseCount || game.phaseType != lastPhaseType;
+    lastPhaseCount = game.phaseCount;
+    lastPhaseType = game.phaseType;
+    ScopedTrace trace("daideSend");
+    for (auto& client : clients) {
+        if (!client->started) continue;
+        if (phaseChanged) sendPhase(*client);
+        forwardPress(*client);
+    }
+    for (size_t i = clients.size(); i > 0; i--) {
+        if (!flush(*clients[i - 1])) drop(i - 1);
+    }
+}
+
+void DaideServer::accept() {
+    int socket;
+    while ((socket = ::accept(listener, nullptr, nullptr)) >= 0) {
+        fcntl(socket, F_SETFL, O_NONBLOCK);
+        auto client = std::make_unique<Client>();
+        client->socket = socket;
+        client->power = nullptr;
+        client->started = false;
+        clients.push_back(std::move(client));
+    }
+}
+
+void DaideServer::drop(size_t index) {
+    game.unsubscribePress(clients[index]->press);
+    close(clients[index]->socket);
+    clients.erase(clients.begin() + index);
+}
+
+// Handles every complete message in the buffer in place, then drops the consumed bytes.
+bool DaideServer::receive(Client& client) {
+    ScopedTrace trace("daideReceive");
+    unsigned char buffer[4096];
+    ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return true;
+    if (received <= 0) return false;
+    client.input.insert(client.input.end(), buffer, buffer + received);
+    size_t at = 0;
+    while (client.input.size() - at >= 4) {
+        const unsigned char* header = client.input.data() + at;
+        size_t length = size_t(header[2]) << 8 | header[3];
+        if (client.input.size() - at < 4 + length) break;
+        unsigned char type = header[0];
+        at += 4 + length;
+        if (type == IM) {
+            if (length < 4 || (header[6] << 8 | header[7]) != 0xDA10) return false;
+            std::vector<unsigned char> representation;
+            for (const auto& [token, name] : tokenNames) {
+                if ((token >> 8) < 0x50 && (token & 0xFF00) != POWER) continue;
+                char padded[4] = {' ', ' ', ' ', '\0'};
+                std::memcpy(padded, name.data(), std::min<size_t>(3, name.size()));
+                representation.insert(representation.end(), {uint8_t(token >> 8), uint8_t(token & 0xFF)});
+                representation.insert(representation.end(), padded, padded + 4);
+            }
+            client.output.insert(client.output.end(), {RM, 0, uint8_t(representation.size() >> 8), uint8_t(representation.size() & 0xFF)});
+            client.output.insert(client.output.end(), representation.begin(), representation.end());
+        } else if (type == DM) {
+            if (length == 0 || length % 2) return false; // tokens are 2 bytes, a DM has at least one
+            try {
+                handle(client, DaideTokens(header + 4, length / 2));
+            } catch (const std::exception&) {
+                std::vector<uint16_t> tokens{HUH, BRA};
+                DaideTokens message(header + 4, length / 2);
+                for (size_t i = 0; i < message.size(); i++) tokens.push_back(message[i]);
+                tokens.push_back(KET);
+                send(client, DM, tokens);
+            }
+        } else if (type == FM || type == EM) {
+            return false;
+        }
+    }
+    client.input.erase(client.input.begin(), client.input.begin() + at);
+    return true;
+}
+
+// Queues the message; poll writes it out.
+void DaideServer::send(Client& client, unsigned char type, const std::vector<uint16_t>& tokens) {
+    client.output.insert(client.output.end(), {type, 0, uint8_t(tokens.size() * 2 >> 8), uint8_t(tokens.size() * 2 & 0xFF)});
+    for (uint16_t token : tokens) {
+        client.output.push_back(uint8_t(token >> 8));
+        client.output.push_back(uint8_t(token & 0xFF));
+    }
+}
+
+// Writes as much queued output as the socket takes. False if the connection failed or the
+// client has fallen more than outputLimit bytes behind.
+bool DaideServer::flush(Client& client) {
+    size_t sent = 0;
+    while (sent < client.output.size()) {
+        ssize_t written = ::send(client.socket, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (written <= 0) return false;
+        sent += size_t(written);
+    }
+    client.output.erase(client.output.begin(), client.output.begin() + sent);
+    return client.output.size() <= outputLimit;
+}
+
+void DaideServer::handle(Client& client, DaideTokens message) {
+    auto echo = [&message](uint16_t reply) {
+        std::vector<uint16_t> tokens{reply, BRA};
+        for (size_t i = 0; i < message.size(); i++) tokens.push_back(message[i]);
+        tokens.push_back(KET);
+        return tokens;
+    };
+    auto mapName = [](std::vector<uint16_t> tokens) {
+        tokens.insert(tokens.end(), {MAP, BRA});
+        for (char c : std::string("pisDiplomacy")) tokens.push_back(uint16_t(TEXT | c));
+        tokens.push_back(KET);
+        return tokens;
+    };
+    uint16_t command = message[0];
+    bool negated = command == NOT;
+    if (negated) command = message.group(1)[0];
+
+    // A client claims one power or observes, once; a power held by another client is refused.
+    if (command == NME || command == OBS || command == IAM) {
+        auto taken = [this](const Player* power) {
+            return std::any_of(clients.begin(), clients.end(), [power](const auto& other) { return other->power == power; });
+        };
+        if (client.power) {
+            send(client, DM, echo(REJ));
+            return;
+        }
+        if (command == OBS) {
+            client.power = game.allPlayers[0].get();
+        } else if (command == IAM) {
+            auto powerIt = std::find(powerTokens.begin(), powerTokens.end(), message.group(1)[0]);
+            if (powerIt == powerTokens.end() || powerIt == powerTokens.begin()
+                || taken(game.allPlayers[powerIt - powerTokens.begin()].get())) {
+                send(client, DM, echo(REJ));
+                return;
+            }
+            client.power = game.allPlayers[powerIt - powerTokens.begin()].get();
+        } else {
+            for (size_t i = 1; i < game.allPlayers.size() && !client.power; i++) {
+                if (!taken(game.allPlayers[i].get())) client.power = game.allPlayers[i].get();
+            }
+            if (!client.power) {
+                send(client, DM, echo(REJ));
+                return;
+            }
+        }
+        client.press.recipient = client.power->id;
+        game.subscribePress(client.press);
+        send(client, DM, echo(YES));
+        send(client, DM, mapName({}));
+    } else if (command == MAP) {
+        send(client, DM, mapName({}));
+    } else if (command == MDF) {
+        sendMap(client);
+    } else if (command == YES && message.group(1)[0] == MAP) {
+        client.started = true;
+        if (client.power && client.power->id != 0) {
+            send(client, DM, {HLO, BRA, powerTokens[client.power->id], KET, BRA, uint16_t(client.power->id), KET, BRA, KET});
+        }
+        sendPhase(client);
+    } else if (command == NOW || command == SCO) {
+        sendPhase(client);
+    } else if (!client.power || client.power->id == 0) {
+        send(client, DM, echo(REJ));
+    } else if (command == SUB) {
+        for (size_t at = 1; at < message.size(); at = message.skip(at)) {
+            DaideTokens order = message.group(at);
+            std::vector<uint16_t> reply{THX, BRA};
+            for (size_t i = 0; i < order.size(); i++) reply.push_back(order[i]);
+            reply.push_back(KET);
+            try {
+                game.submitOrder(client.power, orderText(client.power, order));
+                reply.insert(reply.end(), {BRA, MBV, KET});
+                send(client, DM, reply);
+            } catch (const std::exception&) {
+                reply[0] = SUB;
+                std::vector<uint16_t> rejected{REJ, BRA};
+                rejected.insert(rejected.end(), reply.begin(), reply.end());
+                rejected.push_back(KET);
+                send(client, DM, rejected);
+            }
+        }
+    } else if (command == GOF) {
+        send(client, DM, echo(YES));
+        game.setReady(client.power, !negated);
+    } else if (command == DRW) {
+        game.setVote(client.power, !negated);
+        send(client, DM, echo(YES));
+    } else if (command == SND) {
+        size_t at = 1;
+        if (message[at] == BRA && message.group(at).size() == 2 && (message.group(at)[0] >> 8) == 0x47) {
+            at = message.skip(at); // optional turn
+        }
+        DaideTokens recipients = message.group(at);
+        std::string text = render(message.group(message.skip(at)));
+        for (size_t i = 0; i < recipients.size(); i++) {
+            auto powerIt = std::find(powerTokens.begin() + 1, powerTokens.end(), recipients[i]);
+            if (powerIt == powerTokens.end()) throw std::runtime_error("Unknown DAIDE power");
+            game.sendPress(client.power, game.allPlayers[powerIt - powerTokens.begin()].get(), text);
+        }
+        send(client, DM, echo(YES));
+    } else if (command == TME) {
+        send(client, DM, echo(YES));
+    } else if (command == OFF) {
+        shutdown(client.socket, SHUT_RDWR);
+    } else {
+        send(client, DM, echo(HUH));
+    }
+}
+
+// Sends SCO and NOW for the current phase. Phases map onto DAIDE seasons with buildTime
+// move phases per year: the last one is FAL/AUT, the others SPR/SUM, builds are WIN.
+void DaideServer::sendPhase(Client& client) {
+    uint moves = std::max(1u, game.buildTime);
+    uint year = 1901 + (game.phaseCount - 1) / moves;
+    bool last = (game.phaseCount - 1) % moves == moves - 1;
+    uint16_t season = game.phaseType == 2 ? WIN : game.phaseType == 1 ? (last ? AUT : SUM) : (last ? FAL : SPR);
+
+    std::vector<uint16_t> centres{SCO};
+    std::vector<uint16_t> unowned{BRA, UNO};
+    for (size_t i = 1; i < game.allPlayers.size(); i++) {
+        centres.insert(centres.end(), {BRA, powerTokens[i]});
+        for (size_t t = 0; t < game.allTerritories.size(); t++) {
+            if (game.allTerritories[t]->center && game.allTerritories[t]->owner == game.allPlayers[i].get()) {
+                centres.push_back(provinceTokens[t]);
+            }
+        }
+        centres.push_back(KET);
+    }
+    for (size_t t = 0; t < game.allTerritories.size(); t++) {
+        if (game.allTerritories[t]->center && !game.allTerritories[t]->owner) unowned.push_back(provinceTokens[t]);
+    }
+    unowned.push_back(KET);
+    centres.insert(centres.end(), unowned.begin(), unowned.end());
+    send(client, DM, centres);
+
+    std::vector<uint16_t> now{NOW, BRA, season, uint16_t(year), KET};
+    for (size_t i = 1; i < game.allPlayers.size(); i++) {
+        for (Part* part : game.allPlayers[i]->units) {
+            std::vector<uint16_t> where = location(part->name);
+            now.insert(now.end(), {BRA, powerTokens[i], part->LC ? FLT : AMY});
+            now.insert(now.end(), where.begin(), where.end());
+            now.push_back(KET);
+        }
+    }
+    send(client, DM, now);
+}
+
+// `PROV` for whole provinces and land/single-coast parts, `( PROV COAST )` for split coasts.
+std::vector<uint16_t> DaideServer::location(const std::string& name) {
+    size_t split = name.find('_');
+    std::string territoryName = name.substr(0, split);
+    Territory* territory = game.findTerritory(territoryName);
+    if (!territory) {
+        throw std::runtime_error("Unknown territory " + territoryName);
+    }
+    uint16_t province = provinceTokens[territory->id];
+    std::string suffix = split == std::string::npos ? "" : name.substr(split + 1);
+    for (const auto& [coast, token] : daideCoasts) {
+        if (suffix == coast) return {BRA, province, token, KET};
+    }
+    return {province};
+}
+
+void DaideServer::sendMap(Client& client) {
+    json mapJson = json::parse(*game.mapRaw);
+    std::vector<uint16_t> tokens{MDF, BRA};
+    for (size_t i = 1; i < powerTokens.size(); i++) tokens.push_back(powerTokens[i]);
+    tokens.insert(tokens.end(), {KET, BRA, BRA});
+    for (size_t i = 1; i < game.allPlayers.size(); i++) {
+        tokens.insert(tokens.end(), {BRA, powerTokens[i]});
+        for (Territory* home : game.allPlayers[i]->allowBuild) {
+            tokens.push_back(provinceTokens[home->id]);
+        }
+        tokens.push_back(KET);
+    }
+    tokens.insert(tokens.end(), {BRA, UNO});
+    for (size_t t = 0; t < game.allTerritories.size(); t++) {
+        Territory* territory = game.allTerritories[t].get();
+        bool home = std::any_of(game.allPlayers.begin(), game.allPlayers.end(), [territory](const auto& p) {
+            return std::find(p->allowBuild.begin(), p->allowBuild.end(), territory) != p->allowBuild.end();
+        });
+        if (territory->center && !home) tokens.push_back(provinceTokens[t]);
+    }
+    tokens.insert(tokens.end(), {KET, KET, BRA});
+    for (size_t t = 0; t < game.allTerritories.size(); t++) {
+        if (!game.allTerritories[t]->center) tokens.push_back(provinceTokens[t]);
+    }
+    tokens.insert(tokens.end(), {KET, KET, BRA});
+    for (size_t t = 0; t < game.allTerritories.size(); t++) {
+        Territory* territory = game.allTerritories[t].get();
+        tokens.insert(tokens.end(), {BRA, provinceTokens[t]});
+        for (auto& part : territory->parts) {
+            std::vector<uint16_t> unit = location(part->name);
+            tokens.push_back(BRA);
+            if (unit.size() > 1) {
+                tokens.insert(tokens.end(), {BRA, FLT, unit[2], KET});
+            } else {
+                tokens.push_back(part->LC ? FLT : AMY);
+            }
+            for (const auto& neighbor : mapJson[territory->name][part->name]) {
+                std::vector<uint16_t> where = location(neighbor.get<std::string>());
+                tokens.insert(tokens.end(), where.begin(), where.end());
+            }
+            tokens.push_back(KET);
+        }
+        tokens.push_back(KET);
+    }
+    tokens.push_back(KET);
+    send(client, DM, tokens);
+}
+
+// Location is a province token, or a bracketed province and coast, at `at`.
+Part* DaideServer::partAt(DaideTokens tokens, size_t at, bool fleet) {
+    uint16_t province = tokens[at];
+    uint16_t coast = 0;
+    if (province == BRA) {
+        DaideTokens inner = tokens.group(at);
+        province = inner[0];
+        coast = inner.size() > 1 ? inner[1] : 0;
+    }
+    auto territoryIt = provinces.find(province);
+    if (territoryIt == provinces.end()) throw std::runtime_error("Unknown DAIDE province");
+    for (auto& part : territoryIt->second->parts) {
+        if (part->LC != (fleet ? 1 : 0)) continue;
+        std::vector<uint16_t> where = location(part->name);
+        if (!coast || (where.size() == 4 && where[2] == coast)) return part.get();
+    }
+    throw std::runtime_error("No matching part in " + territoryIt->second->name);
+}
+
+// Translates one DAIDE order into log.json order text.
+std::string DaideServer::orderText(Player* power, DaideTokens order) {
+    DaideTokens unit = order.group(0);
+    bool fleet = unit[1] == FLT;
+    Part* part = partAt(unit, 2, fleet);
+    size_t at = order.skip(0);
+    uint16_t type = order[at];
+    auto moverPart = [this](DaideTokens mover) { return partAt(mover, 2, mover[1] == FLT); };
+    switch (type) {
+        case HLD: return part->name + " H";
+        case MTO: return part->name + " M " + partAt(order, at + 1, fleet)->name;
+        case RTO: return part->name + " R " + partAt(order, at + 1, fleet)->name;
+        case DSB: case REM: return part->name + " D";
+        case BLD: return part->name + " B";
+        case CTO: return part->name + " V " + partAt(order, at + 1, false)->name;
+        case SUP: {
+            DaideTokens supported = order.group(at + 1);
+            Part* target = moverPart(supported);
+            size_t next = order.skip(at + 1);
+            if (next >= order.size()) return part->name + " S " + target->name;
+            return part->name + " S " + partAt(order, next + 1, supported[1] == FLT)->name + " from " + target->name;
+        }
+        case CVY: {
+            Part* army = moverPart(order.group(at + 1));
+            return part->name + " C " + partAt(order, order.skip(at + 1) + 1, false)->name + " from " + army->name;
+        }
+        default: throw std::runtime_error(power->name + " sent an unsupported DAIDE order");
+    }
+}
+
+// Press is stored as text: known tokens by name, others as #XXXX, so it round-trips.
+std::string DaideServer::render(DaideTokens tokens) const {
+    std::string text;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (!text.empty()) text += ' ';
+        uint16_t token = tokens[i];
+        if ((token >> 8) == (TEXT >> 8)) {
+            text += '\'';
+            for (; i < tokens.size() && (tokens[i] >> 8) == (TEXT >> 8); i++) text += char(tokens[i] & 0xFF);
+            text += '\'';
+            i--;
+        } else if (token < 0x4000) {
+            text += std::to_string(token & 0x2000 ? int(token) - 0x4000 : int(token));
+        } else {
+            auto nameIt = tokenNames.find(token);
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "#%04X", token);
+            text += nameIt != tokenNames.end() ? nameIt->second : hex;
+        }
+    }
+    return text;
+}
+
+bool DaideServer::encode(std::string_view text, std::vector<uint16_t>& tokens) const {
+    std::istringstream words{std::string(text)};
+    for (std::string word; words >> word;) {
+        if (word.front() == '\'') {
+            while (word.size() < 2 || word.back() != '\'') {
+                std::string more;
+                if (!(words >> more)) return false;
+                word += ' ' + more;
             }
+            for (size_t i = 1; i + 1 < word.size(); i++) tokens.push_back(uint16_t(TEXT | uint8_t(word[i])));
+        } else if (word.front() == '#') {
+            tokens.push_back(uint16_t(std::stoul(word.substr(1), nullptr, 16)));
+        } else if (std::isdigit(static_cast<unsigned char>(word.back()))) {
+            tokens.push_back(uint16_t(std::stoi(word) & 0x3FFF));
+        } else {
+            auto tokenIt = nameTokens.find(word);
+            if (tokenIt == nameTokens.end()) return false;
+            tokens.push_back(tokenIt->second);
+        }
+    }
+    return true;
+}
+
+// Free-text press from the text interface has no DAIDE form and is not forwarded.
+void DaideServer::forwardPress(Client& client) {
+    while (!client.press.queue.empty()) {
+        PressRef message = std::move(client.press.queue.front());
+        client.press.queue.pop_front();
+        if (client.power && message->sender == client.power->id) continue;
+        std::vector<uint16_t> tokens{FRM, BRA, powerTokens[message->sender], KET, BRA};
+        if (message->recipient == 0) {
+            tokens.insert(tokens.end(), powerTokens.begin() + 1, powerTokens.end());
+        } else {
+            tokens.push_back(powerTokens[message->recipient]);
         }
+        tokens.insert(tokens.end(), {KET, BRA});
+        if (!encode(message->text, tokens)) continue;
+        tokens.push_back(KET);
+        send(client, DM, tokens);
     }
 }
 
+// Benchmarks and tools include this file with PIS_NO_MAIN defined.
+#ifndef PIS_NO_MAIN
 int main() {
     try {
         Game diplomacy("map.json", "rules.json");
@@ -298,4 +4093,5 @@ int main() {
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
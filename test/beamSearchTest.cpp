@@ -0,0 +1,50 @@
+/*
+Beam search bot tests: every unit gets exactly one order whether the search finishes, is cut
+part way, or is cancelled before its first node.
+
+Build: `g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/beamSearchTest.cpp -o beamSearchTest`
+*/
+
+#include "testCommon.h"
+
+// True if the orders name each of the power's units exactly once.
+static bool ordersEveryUnit(const Player* power, const std::vector<std::string>& orders) {
+    std::multiset<std::string> ordered;
+    for (const std::string& order : orders) ordered.insert(order.substr(0, order.find(' ')));
+    std::multiset<std::string> expected;
+    for (const Part* unit : power->units) expected.insert(unit->name);
+    return ordered == expected;
+}
+
+int main() {
+    Fixture fixture(100, 7);
+    Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+    game.initialize();
+    const Player* power = game.player("P1");
+    BeamSearchBot bot(game);
+
+    SearchResult full = bot.search(power);
+    check(full.complete && full.nodes > 0, "an unbounded search completes");
+    check(ordersEveryUnit(power, full.orders), "a complete search orders every unit once");
+
+    std::atomic<bool> cancelled{true};
+    SearchBudget cancelledBudget;
+    cancelledBudget.cancel = &cancelled;
+    SearchResult none = bot.search(power, BeamOptions(), cancelledBudget);
+    check(!none.complete && none.nodes == 0, "a search cancelled up front scores no node");
+    check(ordersEveryUnit(power, none.orders), "a search cut before its first node still orders every unit");
+    check(std::all_of(none.orders.begin(), none.orders.end(), [](const std::string& order) {
+        return order.size() > 2 && order.compare(order.size() - 2, 2, " H") == 0;
+    }), "units a search did not reach hold");
+
+    SearchBudget shortBudget;
+    shortBudget.cpu = std::chrono::nanoseconds(1);
+    SearchResult cut = bot.search(power, BeamOptions(), shortBudget);
+    check(!cut.complete, "a search over its CPU budget stops early");
+    check(ordersEveryUnit(power, cut.orders), "a search cut part way orders every unit once");
+
+    for (const std::string& order : none.orders) game.command("diplomacy --order P1 " + order);
+    check(game.player("P1")->orders.size() == power->units.size(), "the explicit holds are accepted as orders");
+
+    return report("beamSearch");
+}
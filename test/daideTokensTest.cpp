@@ -0,0 +1,149 @@
+/*
+DAIDE parser tests: token reads, groups and skips on well-formed and truncated messages, and
+the server's answers to truncated, empty and odd-length diplomacy messages and to a second
+power claim, and a client that stops reading, over loopback TCP.
+
+Build: `g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/daideTokensTest.cpp -o daideTokensTest`
+*/
+
+#include "testCommon.h"
+
+// Big-endian bytes of the tokens, owned so views into them stay valid.
+static std::vector<unsigned char> bytesOf(const std::vector<uint16_t>& tokens) {
+    std::vector<unsigned char> bytes;
+    for (uint16_t token : tokens) bytes.insert(bytes.end(), {uint8_t(token >> 8), uint8_t(token & 0xFF)});
+    return bytes;
+}
+
+// A DAIDE client on the loopback port, reading whole messages as (type, tokens).
+struct TestClient {
+    int socket;
+    std::vector<unsigned char> input;
+    explicit TestClient(uint16_t port) {
+        socket = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw std::runtime_error("Cannot connect to the DAIDE server");
+        }
+    }
+    ~TestClient() { close(socket); }
+    void send(unsigned char type, const std::vector<unsigned char>& body) {
+        std::vector<unsigned char> bytes{type, 0, uint8_t(body.size() >> 8), uint8_t(body.size() & 0xFF)};
+        bytes.insert(bytes.end(), body.begin(), body.end());
+        ::send(socket, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    }
+    // Next message, polling the server between reads; type -1 once the server has closed.
+    std::pair<int, std::vector<uint16_t>> receive(DaideServer& server) {
+        auto complete = [this]() { return input.size() >= 4 && input.size() >= 4 + size_t(input[2] << 8 | input[3]); };
+        for (int attempt = 0; attempt < 100 && !complete(); attempt++) {
+            server.poll(10);
+            pollfd readable{socket, POLLIN, 0};
+            if (::poll(&readable, 1, 10) <= 0) continue;
+            unsigned char buffer[4096];
+            ssize_t received = recv(socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received == 0) return {-1, {}};
+            if (received > 0) input.insert(input.end(), buffer, buffer + received);
+        }
+        if (!complete()) return {-2, {}};
+        size_t end = 4 + size_t(input[2] << 8 | input[3]);
+        std::vector<uint16_t> tokens;
+        for (size_t i = 4; i + 1 < end; i += 2) tokens.push_back(uint16_t(input[i] << 8 | input[i + 1]));
+        int type = input[0];
+        input.erase(input.begin(), input.begin() + end);
+        return {type, tokens};
+    }
+    // Sends IM and takes a power with NME, reading the RM, YES and MAP replies.
+    void start(DaideServer& server) {
+        send(IM, {0, 1, 0xDA, 0x10});
+        receive(server);
+        send(DM, bytesOf({NME}));
+        receive(server);
+        receive(server);
+    }
+};
+
+int main() {
+    std::vector<unsigned char> nested = bytesOf({SUB, BRA, BRA, AMY, KET, MTO, KET, HLD});
+    DaideTokens message(nested.data(), nested.size() / 2);
+    check(message[0] == SUB && message[7] == HLD, "tokens read big-endian");
+    check(message.skip(0) == 1 && message.skip(1) == 7, "skip steps over a token or a nested group");
+    check(message.group(1).size() == 4 && message.group(1)[3] == MTO, "group is the inside of the brackets");
+    checkThrows([&]() { message[8]; }, "reading past the end");
+    checkThrows([&]() { message.skip(8); }, "skipping past the end");
+    checkThrows([&]() { message.group(8); }, "a group past the end");
+    checkThrows([&]() { message.group(0); }, "a group not starting at a bracket");
+    checkThrows([&]() { message.slice(3, 9); }, "a slice past the end");
+
+    std::vector<unsigned char> unbalanced = bytesOf({SND, BRA, BRA, KET});
+    DaideTokens open(unbalanced.data(), unbalanced.size() / 2);
+    checkThrows([&]() { open.skip(1); }, "skipping an unclosed group");
+    checkThrows([&]() { open.group(1); }, "an unclosed group");
+
+    Fixture fixture(100, 7);
+    Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+    game.initialize();
+    uint16_t port = uint16_t(20000 + getpid() % 20000);
+    DaideServer server(game, port);
+
+    {
+        TestClient client(port);
+        client.start(server);
+        client.send(DM, bytesOf({SND}));
+        auto [type, tokens] = client.receive(server);
+        check(type == DM && !tokens.empty() && tokens[0] == HUH, "a truncated message is answered with HUH");
+        client.send(DM, bytesOf({NOT}));
+        auto [notType, notTokens] = client.receive(server);
+        check(notType == DM && !notTokens.empty() && notTokens[0] == HUH, "NOT without a group is answered with HUH");
+        client.send(DM, bytesOf({YES, BRA, MAP}));
+        auto [openType, openTokens] = client.receive(server);
+        check(openType == DM && !openTokens.empty() && openTokens[0] == HUH, "an unclosed group is answered with HUH");
+    }
+    {
+        TestClient client(port);
+        client.start(server);
+        client.send(DM, {});
+        check(client.receive(server).first == -1, "an empty diplomacy message closes the connection");
+    }
+    {
+        TestClient client(port);
+        client.start(server);
+        client.send(DM, {0x48, 0x09, 0x40});
+        check(client.receive(server).first == -1, "an odd-length diplomacy message closes the connection");
+    }
+    {
+        TestClient first(port);
+        first.start(server);
+        first.send(DM, bytesOf({NME}));
+        auto [nmeType, nmeTokens] = first.receive(server);
+        check(nmeType == DM && !nmeTokens.empty() && nmeTokens[0] == REJ, "a second NME from a client with a power is refused");
+        first.send(DM, bytesOf({OBS}));
+        auto [obsType, obsTokens] = first.receive(server);
+        check(obsType == DM && !obsTokens.empty() && obsTokens[0] == REJ, "OBS from a client with a power is refused");
+        first.send(DM, bytesOf({YES, BRA, MAP, KET}));
+        auto [hloType, hloTokens] = first.receive(server);
+        uint16_t power = hloTokens.size() > 2 ? hloTokens[2] : 0;
+        check(hloType == DM && !hloTokens.empty() && hloTokens[0] == HLO, "the map accepted, the client learns its power");
+        TestClient second(port);
+        second.send(IM, {0, 1, 0xDA, 0x10});
+        second.receive(server);
+        second.send(DM, bytesOf({IAM, BRA, power, KET, BRA, 1, KET}));
+        auto [iamType, iamTokens] = second.receive(server);
+        check(iamType == DM && !iamTokens.empty() && iamTokens[0] == REJ, "IAM for a power another client holds is refused");
+    }
+    {
+        TestClient stalled(port);
+        stalled.start(server);
+        std::vector<unsigned char> requests;
+        for (int i = 0; i < 4000; i++) requests.insert(requests.end(), {DM, 0, 0, 2, uint8_t(MDF >> 8), uint8_t(MDF & 0xFF)});
+        ::send(stalled.socket, requests.data(), requests.size(), MSG_NOSIGNAL);
+        TestClient other(port);
+        other.start(server);
+        other.send(DM, bytesOf({MAP}));
+        check(other.receive(server).first == DM, "a client that stops reading does not stall the others");
+    }
+
+    return report("daideTokens");
+}
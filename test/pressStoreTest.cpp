@@ -0,0 +1,59 @@
+/*
+PressStore tests: press that is not valid UTF-8 is stored with U+FFFD in place of each bad
+byte, so it spills to JSON and reads back; the read floor waits for every tracked player,
+including one that never fetched press, but not for public.
+
+Build: `g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/pressStoreTest.cpp -o pressStoreTest`
+*/
+
+#include "testCommon.h"
+
+static const std::string replacement = "\xEF\xBF\xBD";
+
+static std::string textOf(PressStore& store, uint64_t seq) {
+    return std::string(store.at(seq).text);
+}
+
+int main() {
+    char pattern[] = "/tmp/pisTestXXXXXX";
+    int file = mkstemp(pattern);
+    if (file < 0) throw std::runtime_error("Cannot create temporary file");
+    close(file);
+    std::string spillPath = pattern;
+
+    PressStore store;
+    store.append(1, 2, 0, "bad \xFF byte");
+    store.append(1, 2, 0, "cut \xE2\x82");
+    store.append(1, 2, 0, "surrogate \xED\xA0\x80 overlong \xC0\xAF");
+    store.append(1, 2, 0, "euro \xE2\x82\xAC smile \xF0\x9F\x98\x80");
+    check(textOf(store, 0) == "bad " + replacement + " byte", "a stray byte is replaced");
+    check(textOf(store, 1) == "cut " + replacement + replacement, "a truncated sequence is replaced byte by byte");
+    check(textOf(store, 2) == "surrogate " + replacement + replacement + replacement + " overlong " + replacement + replacement,
+        "surrogates and overlong forms are replaced");
+    check(textOf(store, 3) == "euro \xE2\x82\xAC smile \xF0\x9F\x98\x80", "well-formed UTF-8 is kept");
+
+    while (store.size() < 2 * PressStore::segmentSize) store.append(2, 1, 0, "filler");
+    store.unread(1);
+    store.unread(2);
+    bool spilled = true;
+    try {
+        store.spill(store.readFloor(), spillPath);
+    } catch (const std::exception&) {
+        spilled = false;
+    }
+    check(spilled, "press that had malformed UTF-8 spills");
+    check(textOf(store, 0) == "bad " + replacement + " byte", "spilled press reads back as stored");
+
+    PressStore floorStore;
+    for (uint player = 1; player <= 3; player++) floorStore.track(player);
+    floorStore.append(1, 0, 0, "to everyone");
+    floorStore.append(1, 2, 0, "to P2");
+    floorStore.unread(1);
+    floorStore.unread(2);
+    check(floorStore.readFloor() == 0, "a tracked player that never fetched press holds the floor");
+    floorStore.unread(3);
+    check(floorStore.readFloor() == floorStore.size(), "public press unread as public does not hold the floor");
+
+    std::remove(spillPath.c_str());
+    return report("pressStore");
+}
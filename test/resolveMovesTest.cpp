@@ -0,0 +1,210 @@
+/*
+Move resolution tests on a small hand-made map: bounces, supports and cuts, head-to-head
+battles, rings, convoys, the rule that no power dislodges its own unit, who a retreat phase
+waits for, where a dislodged unit may retreat, army/fleet cross supports among the legal orders, and a fresh log per game.
+
+Board (armies on A-E; X and Y are coastal, joined through the sea S):
+A - B, C, D    B - A, C, E    C - A, B, D, E    D - A, C, X    E - B, C
+
+Build: `g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/resolveMovesTest.cpp -o resolveMovesTest`
+*/
+
+#include "testCommon.h"
+
+using Units = std::set<std::string>;
+
+// Each player's units after one move phase, and the dislodged units as "$playerName $partName".
+struct Outcome {
+    std::map<std::string, Units> units;
+    Units dislodged;
+};
+
+using Placement = std::vector<std::pair<std::string, std::string>>;
+
+// Writes the board with units placed as {"A", "P1"} to map.json and rules.json in directory.
+static void writeBoard(const std::string& directory, const Placement& placed) {
+    json map = {
+        {"A", {{"A_L", {"B", "C", "D"}}}}, {"B", {{"B_L", {"A", "C", "E"}}}},
+        {"C", {{"C_L", {"A", "B", "D", "E"}}}}, {"D", {{"D_L", {"A", "C", "X"}}}}, {"E", {{"E_L", {"B", "C"}}}},
+        {"X", {{"X_L", {"D"}}, {"X_C", {"S"}}}}, {"S", {{"S_C", {"X", "Y"}}}},
+        {"Y", {{"Y_L", json::array()}, {"Y_C", {"S"}}}}
+    };
+    for (auto& [name, territory] : map.items()) {
+        territory["center"] = 0;
+        territory["initPlayer"] = nullptr;
+        territory["initPart"] = nullptr;
+    }
+    for (const auto& [name, player] : placed) {
+        map[name]["initPlayer"] = player;
+        map[name]["initPart"] = name == "S" ? "S_C" : name + "_L";
+    }
+    json rules = {{"winCondition", 99}, {"buildRule", "initCenters"}, {"buildTime", 0}, {"voteShown", 0}, {"drawType", "DSS"}};
+    std::ofstream(directory + "/map.json") << map.dump();
+    std::ofstream(directory + "/rules.json") << rules.dump();
+}
+
+// Plays one move phase from the placed units with the given orders.
+static Outcome run(const std::string& directory, const Placement& placed, const std::vector<std::string>& orders) {
+    writeBoard(directory, placed);
+    Game game(directory + "/map.json", directory + "/rules.json", directory + "/log.json");
+    game.initialize();
+    for (const std::string& order : orders) game.command("diplomacy --order " + order);
+    game.adjudicate();
+    Outcome outcome;
+    for (const auto& [name, player] : placed) {
+        for (const Part* part : game.player(player)->units) outcome.units[player].insert(part->name);
+    }
+    std::istringstream phase(game.snapshot()->phase);
+    for (std::string line; std::getline(phase, line);) {
+        size_t at = line.find(" retreat ");
+        if (at != std::string::npos) outcome.dislodged.insert(line.substr(0, at) + " " + line.substr(at + 9));
+    }
+    return outcome;
+}
+
+int main() {
+    char pattern[] = "/tmp/pisTestXXXXXX";
+    if (!mkdtemp(pattern)) throw std::runtime_error("Cannot create temporary directory");
+    std::string directory = pattern;
+    std::filesystem::path previous = std::filesystem::current_path();
+    std::filesystem::current_path(directory);
+
+    Outcome bounce = run(directory, {{"A", "P1"}, {"B", "P2"}}, {"P1 A_L M to C_L", "P2 B_L M to C_L"});
+    check(bounce.units["P1"] == Units{"A_L"} && bounce.units["P2"] == Units{"B_L"}, "equal moves into one territory bounce");
+
+    Outcome supported = run(directory, {{"A", "P1"}, {"D", "P1"}, {"B", "P2"}},
+        {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 B_L M to C_L"});
+    check(supported.units["P1"] == Units{"C_L", "D_L"} && supported.units["P2"] == Units{"B_L"},
+        "a supported move beats an unsupported one");
+
+    Outcome dislodge = run(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}},
+        {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L H"});
+    check(dislodge.units["P1"] == Units{"C_L", "D_L"} && dislodge.dislodged == Units{"P2 C_L"},
+        "a supported attack dislodges a holding unit");
+
+    Outcome held = run(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}, {"E", "P2"}},
+        {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L H", "P2 E_L S C_L"});
+    check(held.units["P1"] == Units{"A_L", "D_L"} && held.dislodged.empty(), "support to hold stops an equal attack");
+
+    Outcome cut = run(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}, {"B", "P3"}},
+        {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L H", "P3 B_L M to A_L"});
+    check(cut.units["P1"] == Units{"C_L", "D_L"} && cut.units["P3"] == Units{"A_L"} && cut.dislodged == Units{"P2 C_L"},
+        "an attack on a moving unit neither stops it nor cuts its support");
+
+    Outcome cutSupport = run(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}, {"B", "P3"}},
+        {"P1 D_L M to C_L", "P1 A_L S C_L from D_L", "P2 C_L H", "P3 B_L M to A_L"});
+    check(cutSupport.units["P1"] == Units{"A_L", "D_L"} && cutSupport.dislodged.empty(),
+        "an attack on the supporter cuts its support");
+
+    Outcome notCutByTarget = run(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}},
+        {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L M to D_L"});
+    check(notCutByTarget.units["P1"] == Units{"C_L", "D_L"} && notCutByTarget.dislodged == Units{"P2 C_L"},
+        "an attack from the supported-into territory does not cut the support");
+
+    Outcome swap = run(directory, {{"A", "P1"}, {"B", "P2"}}, {"P1 A_L M to B_L", "P2 B_L M to A_L"});
+    check(swap.units["P1"] == Units{"A_L"} && swap.units["P2"] == Units{"B_L"}, "a head-to-head swap without support bounces");
+
+    Outcome headToHead = run(directory, {{"A", "P1"}, {"C", "P1"}, {"B", "P2"}},
+        {"P1 A_L M to B_L", "P1 C_L S B_L from A_L", "P2 B_L M to A_L"});
+    check(headToHead.units["P1"] == Units{"B_L", "C_L"} && headToHead.dislodged == Units{"P2 B_L"},
+        "a supported head-to-head move dislodges the other");
+
+    Outcome ring = run(directory, {{"A", "P1"}, {"B", "P2"}, {"C", "P3"}},
+        {"P1 A_L M to B_L", "P2 B_L M to C_L", "P3 C_L M to A_L"});
+    check(ring.units["P1"] == Units{"B_L"} && ring.units["P2"] == Units{"C_L"} && ring.units["P3"] == Units{"A_L"},
+        "a ring of moves all succeed");
+
+    Outcome blockedRing = run(directory, {{"A", "P1"}, {"B", "P2"}, {"C", "P3"}, {"E", "P4"}},
+        {"P1 A_L M to B_L", "P2 B_L M to C_L", "P3 C_L M to A_L", "P4 E_L M to C_L"});
+    check(blockedRing.units["P1"] == Units{"A_L"} && blockedRing.units["P3"] == Units{"C_L"} && blockedRing.dislodged.empty(),
+        "a bounce inside a ring stops the whole ring");
+
+    Outcome own = run(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P1"}},
+        {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P1 C_L H"});
+    check(own.units["P1"] == Units{"A_L", "C_L", "D_L"} && own.dislodged.empty(), "a power does not dislodge its own unit");
+
+    Outcome foreignSupport = run(directory, {{"A", "P1"}, {"D", "P2"}, {"C", "P2"}},
+        {"P1 A_L M to C_L", "P2 D_L S C_L from A_L", "P2 C_L H"});
+    check(foreignSupport.units["P2"] == Units{"C_L", "D_L"} && foreignSupport.dislodged.empty(),
+        "support from the defending power does not dislodge it");
+
+    Outcome convoy = run(directory, {{"X", "P1"}, {"S", "P1"}}, {"P1 X_L V to Y_L", "P1 S_C C Y_L from X_L"});
+    check(convoy.units["P1"] == Units{"Y_L", "S_C"}, "a convoyed army lands");
+
+    Outcome noRoute = run(directory, {{"X", "P1"}}, {"P1 X_L V to Y_L"});
+    check(noRoute.units["P1"] == Units{"X_L"}, "a convoyed army without fleets stays");
+
+    {
+        writeBoard(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}, {"E", "P3"}});
+        Game game(directory + "/map.json", directory + "/rules.json", directory + "/log.json");
+        game.initialize();
+        for (const char* order : {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L H", "P3 E_L H"}) {
+            game.command(std::string("diplomacy --order ") + order);
+        }
+        game.adjudicate();
+        check(game.snapshot()->phaseType == 1, "a dislodgement starts a retreat phase");
+        check(!game.allReady(), "a retreat phase waits for the dislodged power");
+        game.command("diplomacy --ready P2 1");
+        check(game.snapshot()->phaseType == 0, "the dislodged power alone ends the retreat phase");
+    }
+
+    {
+        writeBoard(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}});
+        Game game(directory + "/map.json", directory + "/rules.json", directory + "/log.json");
+        game.initialize();
+        for (const char* order : {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L H"}) {
+            game.command(std::string("diplomacy --order ") + order);
+        }
+        game.adjudicate();
+        std::vector<std::string> legal = game.legalOrders(game.player("P2"));
+        check(std::find(legal.begin(), legal.end(), "C_L R A_L") == legal.end()
+            && std::find(legal.begin(), legal.end(), "C_L R B_L") != legal.end(),
+            "a dislodged unit may not retreat into its attacker's territory");
+        game.command("diplomacy --order P2 C_L R A_L");
+        game.adjudicate();
+        check(game.player("P2")->units.empty(), "a retreat into the attacker's territory disbands the unit");
+    }
+
+    {
+        writeBoard(directory, {{"A", "P1"}, {"D", "P1"}, {"C", "P2"}, {"B", "P3"}});
+        Game game(directory + "/map.json", directory + "/rules.json", directory + "/log.json");
+        game.initialize();
+        for (const char* order : {"P1 A_L M to C_L", "P1 D_L S C_L from A_L", "P2 C_L M to E_L", "P3 B_L M to E_L"}) {
+            game.command(std::string("diplomacy --order ") + order);
+        }
+        game.adjudicate();
+        check(game.legalOrders(game.player("P2")) == std::vector<std::string>{"C_L D"},
+            "a dislodged unit may not retreat into a territory left empty by a standoff");
+        game.command("diplomacy --order P2 C_L R E_L");
+        game.adjudicate();
+        check(game.player("P2")->units.empty(), "a retreat into a standoff disbands the unit");
+    }
+
+    {
+        writeBoard(directory, {{"D", "P1"}, {"S", "P2"}});
+        Game game(directory + "/map.json", directory + "/rules.json", directory + "/log.json");
+        game.initialize();
+        std::vector<std::string> legal = game.legalOrders(game.player("P1"));
+        check(std::find(legal.begin(), legal.end(), "D_L S X_C from S_C") != legal.end(),
+            "an army may support a fleet moving from sea into a territory it borders");
+        game.command("diplomacy --order P1 D_L S X_C from S_C");
+        check(game.player("P1")->orders.size() == 1, "the army's support of the fleet is accepted");
+    }
+
+    {
+        writeBoard(directory, {{"A", "P1"}});
+        std::ofstream(directory + "/log.json") << "{\n\"Phase 9 move\": {}\n}";
+        Game game(directory + "/map.json", directory + "/rules.json", directory + "/log.json");
+        game.initialize();
+        check(json::parse(std::ifstream(directory + "/log.json")).empty(), "a new game starts with an empty log");
+        game.command("diplomacy --order P1 A_L H");
+        game.adjudicate();
+        game.adjudicate();
+        json log = json::parse(std::ifstream(directory + "/log.json"));
+        check(log.size() == 2 && log.contains("Phase 1 move") && log.contains("Phase 2 move"), "the log holds only this game's phases");
+    }
+
+    std::filesystem::current_path(previous);
+    std::filesystem::remove_all(directory);
+    return report("resolveMoves");
+}
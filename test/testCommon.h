@@ -0,0 +1,46 @@
+/*
+Shared checks for the test binaries in this directory.
+
+Each test is a single translation unit including this header, built with e.g.
+`g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/resolveMovesTest.cpp -o resolveMovesTest`
+
+Output is one line per failed check (std error) and a summary line (std output):
+`{"test": $name, "checks": $n, "failed": $n}`
+the exit status is 1 if any check failed.
+*/
+
+#pragma once
+
+#include "../bench/benchCommon.h"
+
+#include <filesystem>
+#include <map>
+#include <set>
+
+inline int checksRun = 0;
+inline int checksFailed = 0;
+
+inline void check(bool passed, const std::string& what) {
+    checksRun++;
+    if (!passed) {
+        checksFailed++;
+        std::cerr << "Failed: " << what << std::endl;
+    }
+}
+
+// Fails the check if body does not throw.
+template <typename Body>
+void checkThrows(Body body, const std::string& what) {
+    bool threw = false;
+    try {
+        body();
+    } catch (const std::exception&) {
+        threw = true;
+    }
+    check(threw, what + " throws");
+}
+
+inline int report(const std::string& name) {
+    std::cout << json{{"test", name}, {"checks", checksRun}, {"failed", checksFailed}}.dump() << std::endl;
+    return checksFailed ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+/*
+TimerWheel tests: firing on the right tick, cancel, cascading from the upper levels, delays
+longer than the wheel's 64^4 ticks, and a game destroyed while its deadline is pending.
+
+Build: `g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/timerWheelTest.cpp -o timerWheelTest`
+*/
+
+#include "testCommon.h"
+
+using namespace std::chrono;
+
+// Wheel with 1ms ticks whose advance() takes milliseconds since construction.
+struct ManualWheel {
+    steady_clock::time_point start = steady_clock::now();
+    TimerWheel wheel{milliseconds(1)};
+    // start is read before the wheel's own, so the target tick may come out one early.
+    void advanceTo(uint64_t ms) { wheel.advance(start + milliseconds(ms + 1)); }
+};
+
+static void firesOnTime(uint64_t delay, const std::string& name) {
+    ManualWheel clock;
+    TimerWheel::Timer timer;
+    int fired = 0;
+    timer.callback = [&fired]() { fired++; };
+    clock.wheel.schedule(timer, milliseconds(delay));
+    clock.advanceTo(delay - 2);
+    check(fired == 0 && timer.pending(), name + " waits until its expiry");
+    clock.advanceTo(delay);
+    check(fired == 1 && !timer.pending(), name + " fires at its expiry");
+    clock.advanceTo(delay + 200);
+    check(fired == 1, name + " fires once");
+}
+
+int main() {
+    firesOnTime(5, "level 0 timer");
+    firesOnTime(64 * 3 + 7, "level 1 timer");
+    firesOnTime(64 * 64 * 5 + 11, "level 2 timer");
+    firesOnTime(64 * 64 * 64 * 2 + 13, "level 3 timer");
+    // Documented moveDeadline, past 64^4 ticks of 1ms (about 4.7 hours).
+    firesOnTime(86400 * 1000, "timer beyond the wheel's range");
+
+    {
+        ManualWheel clock;
+        TimerWheel::Timer kept, cancelled;
+        int keptFired = 0, cancelledFired = 0;
+        kept.callback = [&keptFired]() { keptFired++; };
+        cancelled.callback = [&cancelledFired]() { cancelledFired++; };
+        clock.wheel.schedule(kept, milliseconds(100));
+        clock.wheel.schedule(cancelled, milliseconds(100));
+        clock.wheel.cancel(cancelled);
+        check(!cancelled.pending(), "cancelled timer is not pending");
+        clock.wheel.cancel(cancelled);
+        clock.advanceTo(150);
+        check(keptFired == 1 && cancelledFired == 0, "cancel removes only the cancelled timer");
+    }
+
+    {
+        ManualWheel clock;
+        TimerWheel::Timer timer;
+        int fired = 0;
+        timer.callback = [&fired]() { fired++; };
+        clock.wheel.schedule(timer, milliseconds(5000));
+        clock.advanceTo(1000);
+        clock.wheel.schedule(timer, milliseconds(50));
+        clock.advanceTo(1060);
+        check(fired == 1, "rescheduling replaces the pending expiry");
+        clock.advanceTo(6000);
+        check(fired == 1, "rescheduled timer does not fire at its old expiry");
+    }
+
+    {
+        ManualWheel clock;
+        TimerWheel::Timer first, second;
+        int secondFired = 0;
+        first.callback = [&]() { clock.wheel.schedule(second, milliseconds(10)); };
+        second.callback = [&secondFired]() { secondFired++; };
+        clock.wheel.schedule(first, milliseconds(10));
+        clock.advanceTo(30);
+        check(secondFired == 1, "a callback can schedule another timer");
+    }
+
+    {
+        Fixture fixture(100, 7);
+        fixture.generated.rules["moveDeadline"] = 1;
+        std::ofstream(fixture.rulesPath) << fixture.generated.rules.dump();
+        ManualWheel clock;
+        TimerWheel::Timer neighbor;
+        int neighborFired = 0;
+        neighbor.callback = [&neighborFired]() { neighborFired++; };
+        {
+            Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+            game.initialize();
+            game.attachTimer(clock.wheel);
+            clock.wheel.schedule(neighbor, seconds(1));
+        }
+        clock.advanceTo(2000);
+        check(neighborFired == 1, "a destroyed game's deadline leaves the wheel intact");
+    }
+
+    return report("timerWheel");
+}
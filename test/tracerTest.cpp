@@ -0,0 +1,50 @@
+/*
+Tracer tests: a full per-thread buffer keeps its first spans and counts the rest as dropped,
+and both a dump and turning tracing on start a new trace from an empty buffer.
+
+Build: `g++ -std=c++17 -O1 -g -pthread -fsanitize=address,undefined -DPIS_NO_MAIN test/tracerTest.cpp -o tracerTest`
+*/
+
+#include "testCommon.h"
+
+static const size_t bufferSpans = 1 << 16; // Tracer::capacity
+
+// Spans and dropped spans in a dump of the current trace.
+static std::pair<size_t, size_t> dumped() {
+    std::ostringstream out;
+    Tracer::dump(out);
+    json trace = json::parse(out.str());
+    size_t spans = 0, dropped = 0;
+    for (const json& event : trace["traceEvents"]) {
+        if (event["ph"] == "X") spans++;
+        if (event["ph"] == "C") dropped += event["args"]["spans"].get<size_t>();
+    }
+    return {spans, dropped};
+}
+
+static void fill() {
+    for (size_t i = 0; i < bufferSpans + 10; i++) Tracer::record("span", i, i + 1);
+}
+
+int main() {
+    Tracer::enable(true);
+    fill();
+    auto [fullSpans, fullDropped] = dumped();
+    check(fullSpans == bufferSpans && fullDropped == 10, "a full buffer keeps its first spans and counts the rest as dropped");
+
+    fill();
+    dumped();
+    Tracer::record("span", 0, 1);
+    auto [dumpSpans, dumpDropped] = dumped();
+    check(dumpSpans == 1 && dumpDropped == 0, "a dump starts a new trace");
+
+    fill();
+    Tracer::enable(false);
+    Tracer::enable(true);
+    Tracer::record("span", 0, 1);
+    auto [enableSpans, enableDropped] = dumped();
+    check(enableSpans == 1 && enableDropped == 0, "turning tracing on starts a new trace");
+
+    Tracer::enable(false);
+    return report("tracer");
+}
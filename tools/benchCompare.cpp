@@ -0,0 +1,199 @@
+/*
+Benchmark baseline recorder and regression comparator.
+
+Usage:
+`benchCompare --record [--baseline $file] [--repetitions $n] $benchCommand ($benchCommand ...)`
+`benchCompare [--baseline $file] [--repetitions $n] [--threshold $percent] [--alpha $p] $benchCommand ...`
+e.g. `benchCompare --record ./scalingBench ./loadBench "./selfPlayBench 100 1000"`
+
+Each bench command runs $n times (default 5). Every JSON line it prints (format in
+bench/benchCommon.h and the scaling bench) contributes one sample per timing metric:
+nsPerOp, loadMs, adjudicateMs and p50Ns, all lower is better. A metric is named
+`$bench/$fixture/$metric`, the scaling bench's fixture being `$territories/$players`.
+
+--record writes every sample to the baseline file (default bench/baseline.json):
+`{"repetitions": $n, "metrics": {"$metric": [$sample, ...]}}`
+Otherwise current samples are compared to the baseline with Welch's t-test. Output is one JSON
+object per metric (std output):
+`{"metric": $metric, "baseline": $mean, "current": $mean, "change": $fraction, "p": $p, "verdict": "ok/slower/faster"}`
+slower means the mean grew by more than the threshold (default 5%) with p below alpha
+(default 0.01); the exit status is 1 if any metric is slower, 2 on errors. Metrics missing
+from either side are reported with verdict "new" or "missing" and do not fail the run.
+
+Build: `g++ -std=c++17 -O2 tools/benchCompare.cpp -o benchCompare`
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+using Samples = std::map<std::string, std::vector<double>>;
+
+static const char* timingMetrics[] = {"nsPerOp", "loadMs", "adjudicateMs", "p50Ns"};
+
+static void runCommand(const std::string& command, Samples& samples) {
+    FILE* output = popen(command.c_str(), "r");
+    if (!output) throw std::runtime_error("Cannot run " + command);
+    std::string line;
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), output)) {
+        line += buffer;
+        if (line.empty() || line.back() != '\n') continue;
+        json result = json::parse(line, nullptr, false);
+        line.clear();
+        if (!result.is_object() || !result.contains("bench")) continue;
+        std::string fixture = result.contains("fixture") ? result["fixture"].get<std::string>()
+            : result.value("territories", 0) ? std::to_string(result["territories"].get<size_t>()) + "/"
+                + std::to_string(result.value("players", size_t(0))) : "";
+        for (const char* metric : timingMetrics) {
+            if (result.contains(metric) && result[metric].is_number()) {
+                samples[result["bench"].get<std::string>() + "/" + fixture + "/" + metric].push_back(result[metric]);
+            }
+        }
+    }
+    if (pclose(output) != 0) throw std::runtime_error(command + " failed");
+}
+
+static double mean(const std::vector<double>& values) {
+    double sum = 0;
+    for (double value : values) sum += value;
+    return sum / double(values.size());
+}
+
+static double variance(const std::vector<double>& values) {
+    if (values.size() < 2) return 0;
+    double average = mean(values), sum = 0;
+    for (double value : values) sum += (value - average) * (value - average);
+    return sum / double(values.size() - 1);
+}
+
+// Regularized incomplete beta I_x(a, b) by Lentz's continued fraction.
+static double incompleteBeta(double a, double b, double x) {
+    if (x <= 0) return 0;
+    if (x >= 1) return 1;
+    if (x > (a + 1) / (a + b + 2)) return 1 - incompleteBeta(b, a, 1 - x);
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1 - x)) / a;
+    const double tiny = 1e-300;
+    double f = 1, c = 1, d = 0;
+    for (int i = 0; i <= 200; i++) {
+        int m = i / 2;
+        double numerator;
+        if (i == 0) {
+            numerator = 1;
+        } else if (i % 2 == 0) {
+            numerator = (m * (b - m) * x) / ((a + 2 * m - 1) * (a + 2 * m));
+        } else {
+            numerator = -((a + m) * (a + b + m) * x) / ((a + 2 * m) * (a + 2 * m + 1));
+        }
+        d = 1 + numerator * d;
+        d = 1 / (std::fabs(d) < tiny ? tiny : d);
+        c = 1 + numerator / c;
+        if (std::fabs(c) < tiny) c = tiny;
+        f *= c * d;
+        if (std::fabs(1 - c * d) < 1e-10) break;
+    }
+    return front * (f - 1);
+}
+
+// Two-sided p-value of Welch's t-test that both sample sets share a mean.
+static double welchP(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.size() < 2 || b.size() < 2) return 1;
+    double va = variance(a) / double(a.size()), vb = variance(b) / double(b.size());
+    if (va + vb == 0) return mean(a) == mean(b) ? 1 : 0;
+    double t = (mean(a) - mean(b)) / std::sqrt(va + vb);
+    double freedom = (va + vb) * (va + vb)
+        / (va * va / double(a.size() - 1) + vb * vb / double(b.size() - 1));
+    return incompleteBeta(freedom / 2, 0.5, freedom / (freedom + t * t));
+}
+
+int main(int argc, char** argv) {
+    bool record = false;
+    std::string baselinePath = "bench/baseline.json";
+    int repetitions = 5;
+    double threshold = 0.05, alpha = 0.01;
+    std::vector<std::string> commands;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string argument = argv[i];
+            auto value = [&]() {
+                if (i + 1 >= argc) throw std::runtime_error(argument + " needs a value");
+                return std::string(argv[++i]);
+            };
+            if (argument == "--record") {
+                record = true;
+            } else if (argument == "--baseline") {
+                baselinePath = value();
+            } else if (argument == "--repetitions") {
+                repetitions = std::stoi(value());
+            } else if (argument == "--threshold") {
+                threshold = std::stod(value()) / 100;
+            } else if (argument == "--alpha") {
+                alpha = std::stod(value());
+            } else {
+                commands.push_back(argument);
+            }
+        }
+        if (commands.empty() || repetitions < 1) {
+            std::cerr << "Usage: benchCompare [--record] [--baseline $file] [--repetitions $n] "
+                "[--threshold $percent] [--alpha $p] $benchCommand ($benchCommand ...)" << std::endl;
+            return 2;
+        }
+
+        // Repetitions interleave the commands so slow drift on the machine hits every bench alike.
+        Samples current;
+        for (int r = 0; r < repetitions; r++) {
+            for (const std::string& command : commands) runCommand(command, current);
+        }
+
+        if (record) {
+            json metrics = json::object();
+            for (const auto& [metric, values] : current) metrics[metric] = values;
+            std::ofstream file(baselinePath);
+            if (!file) throw std::runtime_error("Cannot write " + baselinePath);
+            file << json{{"repetitions", repetitions}, {"metrics", metrics}}.dump(2) << std::endl;
+            std::cout << json{{"recorded", current.size()}, {"baseline", baselinePath}}.dump() << std::endl;
+            return 0;
+        }
+
+        std::ifstream file(baselinePath);
+        if (!file) throw std::runtime_error("Cannot read " + baselinePath + ", record one with --record");
+        json baselineJson = json::parse(file);
+        Samples baseline;
+        for (auto& [metric, values] : baselineJson["metrics"].items()) baseline[metric] = values.get<std::vector<double>>();
+
+        bool slower = false;
+        for (const auto& [metric, values] : current) {
+            auto it = baseline.find(metric);
+            if (it == baseline.end()) {
+                std::cout << json{{"metric", metric}, {"current", mean(values)}, {"verdict", "new"}}.dump() << std::endl;
+                continue;
+            }
+            double before = mean(it->second), after = mean(values);
+            double change = before > 0 ? after / before - 1 : 0;
+            double p = welchP(it->second, values);
+            std::string verdict = "ok";
+            if (p < alpha && change > threshold) verdict = "slower";
+            if (p < alpha && change < -threshold) verdict = "faster";
+            slower = slower || verdict == "slower";
+            std::cout << json{{"metric", metric}, {"baseline", before}, {"current", after}, {"change", change},
+                {"p", p}, {"verdict", verdict}}.dump() << std::endl;
+        }
+        for (const auto& [metric, values] : baseline) {
+            if (!current.count(metric)) {
+                std::cout << json{{"metric", metric}, {"baseline", mean(values)}, {"verdict", "missing"}}.dump() << std::endl;
+            }
+        }
+        return slower ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+Determinism checker: plays the same seeded self-play game under every engine path and thread
+count, hashing the state after each phase, and reports the first phase where a run's hash
+differs from the reference, which resolves the whole board as a single region.
+
+Usage:
+`determinismCheck ($territories $players $seed $phases)`, default 1000 20 1 50
+Orders are one random legal order per unit, drawn from a generator seeded with $seed, so runs
+only diverge if the engine does. Paths are movePhase over the order regions on the game's own
+thread (serial), and pooled with parallelThreshold 0 on 1, 2 and hardware-concurrency threads.
+
+Output is one JSON object per path (std output):
+`{"mode": $mode, "phases": $n, "match": true}`
+`{"mode": $mode, "phases": $n, "match": false, "divergedAt": $phaseIndex, "phase": "Phase $phaseCount $phaseType", "expected": $hash, "actual": $hash}`
+the exit status is 1 if any path diverges.
+
+Build: `g++ -std=c++17 -O2 -pthread -DPIS_NO_MAIN tools/determinismCheck.cpp -o determinismCheck`
+*/
+
+#include "../bench/benchCommon.h"
+
+struct PhaseHash {
+    uint64_t hash;
+    std::string phase;
+};
+
+// Plays `phases` phases and returns the state hash after initialize() and after every phase.
+static std::vector<PhaseHash> play(const Fixture& fixture, ThreadPool* pool, int phases, bool partitioned = true) {
+    static const char* phaseNames[] = {"move", "retreat", "build"};
+    Game game(fixture.mapPath, fixture.rulesPath, fixture.logPath);
+    game.initialize();
+    game.partitionRegions(partitioned);
+    if (pool) game.attachPool(*pool, 0);
+    std::mt19937 rng(fixture.spec.seed);
+    std::vector<std::string> names;
+    for (size_t p = 1; p <= fixture.spec.players; p++) names.push_back("P" + std::to_string(p));
+    std::vector<PhaseHash> hashes;
+    auto mark = [&]() {
+        std::shared_ptr<const StateSnapshot> state = game.snapshot();
+        hashes.push_back({game.stateHash(), "Phase " + std::to_string(state->phaseCount) + " " + phaseNames[state->phaseType]});
+    };
+    mark();
+    for (int phase = 0; phase < phases; phase++) {
+        for (const std::string& name : names) {
+            for (const std::string& order : randomOrders(game.legalOrders(game.player(name)), rng)) {
+                game.command("diplomacy --order " + name + " " + order);
+            }
+        }
+        game.adjudicate();
+        mark();
+    }
+    return hashes;
+}
+
+int main(int argc, char** argv) {
+    size_t territories = 1000, players = 20;
+    uint32_t seed = 1;
+    int phases = 50;
+    if (argc > 1 && argc < 5) {
+        std::cerr << "Usage: determinismCheck ($territories $players $seed $phases)" << std::endl;
+        return 2;
+    }
+    if (argc >= 5) {
+        territories = std::stoul(argv[1]);
+        players = std::stoul(argv[2]);
+        seed = std::stoul(argv[3]);
+        phases = std::stoi(argv[4]);
+    }
+    try {
+        Fixture fixture(territories, players, seed);
+        FixtureDirectory inFixture(fixture);
+        std::vector<PhaseHash> reference = play(fixture, nullptr, phases, false);
+
+        bool diverged = false;
+        auto compare = [&](const std::string& mode, const std::vector<PhaseHash>& run) {
+            json result{{"mode", mode}, {"phases", phases}, {"match", true}};
+            for (size_t i = 0; i < reference.size(); i++) {
+                if (run[i].hash != reference[i].hash) {
+                    result["match"] = false;
+                    result["divergedAt"] = i;
+                    result["phase"] = run[i].phase;
+                    result["expected"] = reference[i].hash;
+                    result["actual"] = run[i].hash;
+                    diverged = true;
+                    break;
+                }
+            }
+            std::cout << result.dump() << std::endl;
+        };
+        compare("serial", play(fixture, nullptr, phases));
+        std::vector<size_t> threadCounts{1, 2};
+        size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        if (hardware > 2) threadCounts.push_back(hardware);
+        for (size_t threads : threadCounts) {
+            ThreadPool pool(threads);
+            compare("parallel-" + std::to_string(threads), play(fixture, &pool, phases));
+        }
+        return diverged ? 1 : 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,213 @@
+/*
+Synthetic map generator for scaling tests.
+Writes "map.json" and "rules.json" in the formats described in pisDiplomacy.cpp.
+
+Usage:
+`mapGenerator $territories $players $seed $outputDirectory`
+
+Territories are laid out on a grid with one diagonal per cell so adjacency stays planar.
+Smoothed noise turns about 30% of them into seas; land next to sea gets a coast part, and a
+few coastal territories with several seas get split coasts (_NC/_SC). Each player gets 3
+home centers grown from an anchor spread over the board.
+
+Build: `g++ -std=c++17 -O2 tools/mapGenerator.cpp -o mapGenerator`
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+struct MapSpec {
+    size_t territories = 1000;
+    size_t players = 7;
+    uint32_t seed = 1;
+    double seaShare = 0.3;
+    double centerShare = 0.6; // of land territories
+    double splitCoastShare = 0.05; // of coastal territories with at least two seas
+};
+
+struct GeneratedMap {
+    json map;
+    json rules;
+};
+
+GeneratedMap generateMap(const MapSpec& spec) {
+    const size_t n = std::max<size_t>(spec.territories, spec.players * 3);
+    const size_t width = std::max<size_t>(1, size_t(std::ceil(std::sqrt(double(n)))));
+    std::mt19937 rng(spec.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<std::vector<size_t>> adjacent(n);
+    auto connect = [&adjacent](size_t a, size_t b) {
+        adjacent[a].push_back(b);
+        adjacent[b].push_back(a);
+    };
+    for (size_t i = 0; i < n; i++) {
+        size_t x = i % width;
+        if (x + 1 < width && i + 1 < n) connect(i, i + 1);
+        if (i + width < n) connect(i, i + width);
+        if (x + 1 < width && i + width + 1 < n && (i / width) % 2 == 0) connect(i, i + width + 1);
+        if (x > 0 && i + width - 1 < n && (i / width) % 2 == 1) connect(i, i + width - 1);
+    }
+
+    // Smoothed noise thresholded at the sea quantile gives contiguous seas.
+    std::vector<double> noise(n);
+    for (double& value : noise) value = uniform(rng);
+    for (int pass = 0; pass < 3; pass++) {
+        std::vector<double> smoothed(n);
+        for (size_t i = 0; i < n; i++) {
+            double sum = noise[i];
+            for (size_t j : adjacent[i]) sum += noise[j];
+            smoothed[i] = sum / double(adjacent[i].size() + 1);
+        }
+        noise.swap(smoothed);
+    }
+    std::vector<double> sorted = noise;
+    std::sort(sorted.begin(), sorted.end());
+    double seaLevel = sorted[std::min(n - 1, size_t(spec.seaShare * double(n)))];
+    std::vector<bool> sea(n);
+    for (size_t i = 0; i < n; i++) sea[i] = spec.seaShare > 0 && noise[i] < seaLevel;
+
+    // Coasts of each land territory: the seas each coast part touches.
+    std::vector<std::vector<std::vector<size_t>>> coasts(n);
+    for (size_t i = 0; i < n; i++) {
+        if (sea[i]) continue;
+        std::vector<size_t> seas;
+        for (size_t j : adjacent[i]) {
+            if (sea[j]) seas.push_back(j);
+        }
+        if (seas.empty()) continue;
+        if (seas.size() >= 2 && uniform(rng) < spec.splitCoastShare) {
+            size_t half = seas.size() / 2;
+            coasts[i].emplace_back(seas.begin(), seas.begin() + half);
+            coasts[i].emplace_back(seas.begin() + half, seas.end());
+        } else {
+            coasts[i].push_back(seas);
+        }
+    }
+
+    auto name = [](size_t i) { return "T" + std::to_string(i); };
+    auto coastName = [&](size_t i, size_t c) {
+        if (sea[i]) return name(i) + "_C";
+        if (coasts[i].size() == 1) return name(i) + "_C";
+        return name(i) + (c == 0 ? "_NC" : "_SC");
+    };
+    // Neighbors are territory names, or the coast part name when the territory has split coasts.
+    auto coastReference = [&](size_t i, size_t seaIndex) {
+        if (sea[i] || coasts[i].size() == 1) return name(i);
+        for (size_t c = 0; c < coasts[i].size(); c++) {
+            if (std::find(coasts[i][c].begin(), coasts[i][c].end(), seaIndex) != coasts[i][c].end()) {
+                return coastName(i, c);
+            }
+        }
+        return name(i);
+    };
+
+    GeneratedMap generated;
+    json& map = generated.map;
+    size_t centerCount = 0;
+    for (size_t i = 0; i < n; i++) {
+        json territory;
+        if (sea[i]) {
+            json neighbors = json::array();
+            for (size_t j : adjacent[i]) {
+                if (sea[j] || !coasts[j].empty()) neighbors.push_back(coastReference(j, i));
+            }
+            territory[name(i) + "_C"] = neighbors;
+            territory["center"] = 0;
+        } else {
+            json land = json::array();
+            for (size_t j : adjacent[i]) {
+                if (!sea[j]) land.push_back(name(j));
+            }
+            territory[name(i) + "_L"] = land;
+            for (size_t c = 0; c < coasts[i].size(); c++) {
+                json neighbors = json::array();
+                for (size_t s : coasts[i][c]) neighbors.push_back(name(s));
+                for (size_t j : adjacent[i]) {
+                    if (sea[j] || coasts[j].empty()) continue;
+                    for (size_t s : coasts[i][c]) {
+                        if (std::find(adjacent[j].begin(), adjacent[j].end(), s) != adjacent[j].end()) {
+                            neighbors.push_back(coastReference(j, s));
+                            break;
+                        }
+                    }
+                }
+                territory[coastName(i, c)] = neighbors;
+            }
+            bool center = uniform(rng) < spec.centerShare;
+            territory["center"] = center ? 1 : 0;
+            centerCount += center ? 1 : 0;
+        }
+        territory["initPlayer"] = nullptr;
+        territory["initPart"] = nullptr;
+        map[name(i)] = territory;
+    }
+
+    // Home centers: breadth-first from anchors spread along the grid, 3 unclaimed land each.
+    std::vector<bool> claimed(n, false);
+    for (size_t p = 0; p < spec.players; p++) {
+        std::string playerName = "P" + std::to_string(p + 1);
+        size_t anchor = (p * n) / spec.players + width / 2;
+        std::queue<size_t> frontier;
+        std::vector<bool> seen(n, false);
+        frontier.push(std::min(anchor, n - 1));
+        seen[frontier.front()] = true;
+        int homes = 0;
+        while (!frontier.empty() && homes < 3) {
+            size_t i = frontier.front();
+            frontier.pop();
+            if (!sea[i] && !claimed[i]) {
+                claimed[i] = true;
+                json& territory = map[name(i)];
+                if (territory["center"] == 0) centerCount++;
+                territory["center"] = 1;
+                territory["initPlayer"] = playerName;
+                territory["initPart"] = (homes == 1 && !coasts[i].empty()) ? coastName(i, 0) : name(i) + "_L";
+                homes++;
+            }
+            for (size_t j : adjacent[i]) {
+                if (!seen[j]) {
+                    seen[j] = true;
+                    frontier.push(j);
+                }
+            }
+        }
+    }
+
+    generated.rules = {
+        {"winCondition", centerCount / 2 + 1},
+        {"buildRule", "initCenters"},
+        {"buildTime", 2},
+        {"voteShown", 1},
+        {"drawType", "DSS"}
+    };
+    return generated;
+}
+
+#ifndef PIS_NO_MAIN
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        std::cerr << "Usage: mapGenerator $territories $players $seed $outputDirectory" << std::endl;
+        return 1;
+    }
+    MapSpec spec;
+    spec.territories = std::stoul(argv[1]);
+    spec.players = std::stoul(argv[2]);
+    spec.seed = std::stoul(argv[3]);
+    std::string directory = argv[4];
+    GeneratedMap generated = generateMap(spec);
+    std::ofstream(directory + "/map.json") << generated.map.dump(2) << std::endl;
+    std::ofstream(directory + "/rules.json") << generated.rules.dump(2) << std::endl;
+    return 0;
+}
+#endif